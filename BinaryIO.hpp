@@ -0,0 +1,295 @@
+/**
+ * \file BinaryIO.hpp
+ *
+ * Byte-level primitives shared by the binary file formats: unsigned and
+ * zigzag varints, raw doubles in host byte order, length-prefixed strings
+ * and read-only file mappings.
+ */
+
+#ifndef BINARYIO_HPP
+#define BINARYIO_HPP
+
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * \class BinaryWriter
+ * \brief Class BinaryWriter. Appends encoded values to a growing buffer.
+ */
+class BinaryWriter {
+  
+public:
+
+  /**
+   * \brief Append a single byte.
+   * \return Void.
+   */
+  void put_byte(unsigned char b)
+  {
+    buffer_m += (char) b;
+  }
+
+  /**
+   * \brief Append an unsigned integer, 7 bits per byte with the high bit
+   * marking continuation.
+   * \return Void.
+   */
+  void put_varint(unsigned long v)
+  {
+    while (v >= 0x80) {
+      put_byte((unsigned char) (v | 0x80));
+      v >>= 7;
+    }
+    put_byte((unsigned char) v);
+  }
+
+  /**
+   * \brief Append a signed integer, zigzag mapped so that small negative
+   * values stay short.
+   * \return Void.
+   */
+  void put_svarint(long v)
+  {
+    put_varint(((unsigned long) v << 1) ^ (unsigned long) (v >> (8 * sizeof(long) - 1)));
+  }
+
+  /**
+   * \brief Append the 8 raw bytes of a double.
+   * \return Void.
+   */
+  void put_double(double d)
+  {
+    char bytes[sizeof(double)];
+    memcpy(bytes, &d, sizeof(double));
+    buffer_m.append(bytes, sizeof(double));
+  }
+
+  /**
+   * \brief Append a length-prefixed string.
+   * \return Void.
+   */
+  void put_string(const std::string& s)
+  {
+    put_varint(s.size());
+    buffer_m += s;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The bytes written so far.
+   */
+  const std::string& buffer() const
+  {
+    return buffer_m;
+  }
+
+  /**
+   * \brief Forget the bytes written so far, keeping the allocation.
+   * \return Void.
+   */
+  void clear()
+  {
+    buffer_m.clear();
+  }
+
+private:
+  std::string buffer_m;
+  
+};
+
+/**
+ * \class BinaryReader
+ * \brief Class BinaryReader. Decodes values from a byte range it does not
+ * own (error on reading past the end).
+ */
+class BinaryReader {
+  
+public:
+
+  /**
+   * \brief Constructor taking the bytes in [begin, end).
+   */
+  BinaryReader(const char* begin, const char* end)
+    : pos_m(begin), end_m(end)
+  {
+    
+  }
+
+  /**
+   * \brief Check whether all bytes have been consumed.
+   * \return True iff nothing is left to read.
+   */
+  bool at_end() const
+  {
+    return pos_m == end_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Number of bytes left to read.
+   */
+  unsigned long remaining() const
+  {
+    return end_m - pos_m;
+  }
+
+  /**
+   * \brief Read a single byte.
+   * \return The byte.
+   */
+  unsigned char get_byte() throw (std::runtime_error)
+  {
+    if (pos_m == end_m) {
+      throw std::runtime_error("truncated binary data");
+    }
+    return (unsigned char) *pos_m++;
+  }
+
+  /**
+   * \brief Read an unsigned varint.
+   * \return The value.
+   */
+  unsigned long get_varint() throw (std::runtime_error)
+  {
+    unsigned long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      unsigned char b = get_byte();
+      v |= (unsigned long) (b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+	return v;
+      }
+    }
+    throw std::runtime_error("malformed varint in binary data");
+  }
+
+  /**
+   * \brief Read a zigzag varint.
+   * \return The value.
+   */
+  long get_svarint() throw (std::runtime_error)
+  {
+    unsigned long v = get_varint();
+    return (long) (v >> 1) ^ -(long) (v & 1);
+  }
+
+  /**
+   * \brief Read 8 raw bytes as a double.
+   * \return The value.
+   */
+  double get_double() throw (std::runtime_error)
+  {
+    double d;
+    memcpy(&d, get_bytes(sizeof(double)), sizeof(double));
+    return d;
+  }
+
+  /**
+   * \brief Read a length-prefixed string.
+   * \return The string.
+   */
+  std::string get_string() throw (std::runtime_error)
+  {
+    unsigned long n = get_varint();
+    return std::string(get_bytes(n), n);
+  }
+
+  /**
+   * \brief Consume n bytes without copying them.
+   * \return Pointer to the first of them.
+   */
+  const char* get_bytes(unsigned long n) throw (std::runtime_error)
+  {
+    if ((unsigned long) (end_m - pos_m) < n) {
+      throw std::runtime_error("truncated binary data");
+    }
+    const char* bytes = pos_m;
+    pos_m += n;
+    return bytes;
+  }
+
+private:
+  const char* pos_m;
+  const char* end_m;
+  
+};
+
+/**
+ * \class MappedFile
+ * \brief Class MappedFile. A whole file mapped read-only into memory for
+ * the lifetime of the object.
+ */
+class MappedFile {
+  
+public:
+
+  /**
+   * \brief Constructor mapping the file at path (error if it cannot be
+   * opened or mapped).
+   */
+  MappedFile(const char* path) throw (std::runtime_error)
+    : data_m(NULL), size_m(0)
+  {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error(std::string("cannot open ") + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+      close(fd);
+      throw std::runtime_error(std::string("cannot stat ") + path);
+    }
+    size_m = st.st_size;
+    if (size_m > 0) {
+      data_m = mmap(NULL, size_m, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data_m == MAP_FAILED) {
+	data_m = NULL;
+	close(fd);
+	throw std::runtime_error(std::string("cannot map ") + path);
+      }
+    }
+    close(fd);
+  }
+
+  /**
+   * \brief Destructor unmapping the file.
+   */
+  ~MappedFile()
+  {
+    if (data_m != NULL) {
+      munmap(data_m, size_m);
+    }
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Pointer to the first byte of the file.
+   */
+  const char* begin() const
+  {
+    return static_cast<const char*>(data_m);
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Pointer past the last byte of the file.
+   */
+  const char* end() const
+  {
+    return begin() + size_m;
+  }
+
+private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator= (const MappedFile&);
+  
+  void* data_m;
+  size_t size_m;
+  
+};
+
+#endif // BINARYIO_HPP
@@ -13,12 +13,14 @@
 // implementation, this is the logical place to define it.
 Cell* const nil = NULL;
 
+thread_local long cells_constructed = 0;
+
 using namespace std;
 
 // Cell
 Cell::Cell()
 {
-
+  ++cells_constructed;
 }
 
 Cell::~Cell()
@@ -51,6 +53,21 @@ bool Cell::is_procedure() const
   return false;
 }
 
+bool Cell::is_memoized() const
+{
+  return false;
+}
+
+bool Cell::is_future() const
+{
+  return false;
+}
+
+bool Cell::is_native() const
+{
+  return false;
+}
+
 int Cell::get_int() const
 {
   throw runtime_error("trying to get int from a non-numeric cell");
@@ -66,6 +83,11 @@ string Cell::get_symbol() const
   throw runtime_error("trying to get symbol from a non-symbol cell");
 }
 
+unsigned long Cell::get_symbol_hash() const
+{
+  throw runtime_error("trying to get symbol hash from a non-symbol cell");
+}
+
 Cell* Cell::get_car() const
 {
   throw runtime_error("trying to get car from a non-cons cell");
@@ -86,6 +108,26 @@ Cell* Cell:: get_body() const
   throw runtime_error("trying to get body from a non-procedure cell");
 }
 
+Cell* Cell::get_name() const
+{
+  throw runtime_error("trying to get name from a non-procedure cell");
+}
+
+void Cell::set_name(Cell* const)
+{
+  throw runtime_error("trying to name a non-procedure cell");
+}
+
+MemoCache* Cell::get_memo() const
+{
+  throw runtime_error("trying to get memo cache from a non-memoized cell");
+}
+
+Cell* Cell::touch()
+{
+  throw runtime_error("trying to touch a non-future cell");
+}
+
 void Cell::add_to(bool& is_int, double& cum_sum) const
 {
   throw runtime_error("trying to do addition on a non-numeric cell");
@@ -115,3 +157,10 @@ Cell* Cell::floor() const
 {
   throw runtime_error("trying to do flooring operation on non-double cell");
 }
+
+void Cell::print(ostream& os) const
+{
+  string out;
+  render(out);
+  os << out;
+}
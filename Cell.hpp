@@ -31,6 +31,8 @@
 #include <stack>
 #include <stdexcept>
 
+class MemoCache;
+
 /**
  * \class Cell
  * \brief Abstract base class Cell.
@@ -82,6 +84,24 @@ public:
    */
   virtual bool is_procedure() const;
   
+  /**
+   * \brief Check if this is a memoized ProcedureCell.
+   * \return True iff this is a memoized ProcedureCell.
+   */
+  virtual bool is_memoized() const;
+  
+  /**
+   * \brief Check if this is a FutureCell.
+   * \return True iff this is a FutureCell.
+   */
+  virtual bool is_future() const;
+  
+  /**
+   * \brief Check if this is a NativeProcedureCell.
+   * \return True iff this is a NativeProcedureCell.
+   */
+  virtual bool is_native() const;
+  
   /**
    * \brief Accessor (error if this is not an IntCell or DoubleCell).
    * \return The value in this IntCell.
@@ -100,6 +120,12 @@ public:
    */
   virtual std::string get_symbol() const;
   
+  /**
+   * \brief Accessor (error if this is not a SymbolCell).
+   * \return The hash of the symbol name in this SymbolCell.
+   */
+  virtual unsigned long get_symbol_hash() const;
+  
   /**
    * \brief Accessor (error if this is not a ConsCell).
    * \return First child cell.
@@ -116,6 +142,32 @@ public:
   
   virtual Cell* get_body() const;
   
+  /**
+   * \brief Accessor (error if this is not a ProcedureCell).
+   * \return The symbol the procedure was first defined as, nil if none.
+   */
+  virtual Cell* get_name() const;
+  
+  /**
+   * \brief Record the symbol the procedure is defined as, unless it
+   * already has a name (error if this is not a ProcedureCell).
+   * \return Void.
+   */
+  virtual void set_name(Cell* const name);
+  
+  /**
+   * \brief Accessor (error if this is not a memoized ProcedureCell).
+   * \return The result cache of the procedure.
+   */
+  virtual MemoCache* get_memo() const;
+  
+  /**
+   * \brief Accessor (error if this is not a FutureCell). Waits for the
+   * value if it is still being computed.
+   * \return The value of the future.
+   */
+  virtual Cell* touch();
+  
   /**
    * \brief Add the value stored in the cell to a cummulative sum and set
    * the result type to double if any double is involved in the calculation.
@@ -163,11 +215,17 @@ public:
   virtual Cell* floor() const;
   
   /**
-   * \brief Pure virtual function for printing the subtree rooted at this cell
-   * in s-expression notation.
+   * \brief Pure virtual function for appending the subtree rooted at this
+   * cell in s-expression notation to the end of out.
+   * \param out The buffer to append to.
+   */
+  virtual void render(std::string& out) const = 0;
+
+  /**
+   * \brief Print the subtree rooted at this cell in s-expression notation.
    * \param os The output stream to print to.
    */
-  virtual void print(std::ostream& os = std::cout) const = 0;
+  void print(std::ostream& os = std::cout) const;
   
 };
 
@@ -176,4 +234,10 @@ public:
 // Here we promise this again, just to be safe.
 extern Cell* const nil;
 
+/**
+ * \brief Number of cells constructed by the calling thread so far, for
+ * attributing allocations to the procedures being profiled.
+ */
+extern thread_local long cells_constructed;
+
 #endif // CELL_HPP
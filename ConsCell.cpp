@@ -36,18 +36,25 @@ Cell* ConsCell::get_cdr() const
   return cdr_m;
 }
 
-void ConsCell::print(ostream& os) const
+void ConsCell::set_cdr(Cell* const my_cdr)
 {
-  os << "(";
+  cdr_m = my_cdr;
+}
+
+void ConsCell::render(string& out) const
+{
+  out += '(';
   const Cell* temp_c = this;
   while (temp_c != nil) {
-    temp_c->get_car()->print(os);
+    if (temp_c->get_car() == nil) {
+      out += "()";
+    } else {
+      temp_c->get_car()->render(out);
+    }
     temp_c = temp_c->get_cdr();
     if (temp_c != nil) {
-      os << " ";
+      out += ' ';
     }
   }
-  
-  os << ")";
-  
+  out += ')';
 }
@@ -47,12 +47,19 @@ public:
    * \return Cdr cell pointer stored in the cell.
    */
   virtual Cell* get_cdr() const;
+
+  /**
+   * \brief Replace the cdr, only while the cell is being built and not yet
+   * seen by anything else; cells are immutable afterwards.
+   * \return Void.
+   */
+  void set_cdr(Cell* const my_cdr);
   
   /**
-   * \brief Define the pure virtual print function to print the value stored in the cell.
+   * \brief Define the pure virtual render function to append the value stored in the cell.
    * \return void.
    */
-  virtual void print(std::ostream& os = std::cout) const;
+  virtual void render(std::string& out) const;
 
 private:
   Cell* car_m;
@@ -5,9 +5,9 @@
  */
 
 #include "DoubleCell.hpp"
-#include "IntCell.hpp"
+#include "cons.hpp"
+#include "number.hpp"
 #include <iostream>
-#include <iomanip>
 #include <cmath>
 
 DoubleCell::DoubleCell(const double d)
@@ -70,22 +70,15 @@ void DoubleCell::divide_from(bool& is_int, double& cum_quotient) const
 
 Cell* DoubleCell::ceiling() const
 {
-  return new IntCell( (int) std::ceil(get_double()) );
+  return make_int( (int) std::ceil(get_double()) );
 }
 
 Cell* DoubleCell::floor() const
 {
-  return new IntCell( (int) std::floor(get_double()) );
+  return make_int( (int) std::floor(get_double()) );
 }
 
-void DoubleCell::print(std::ostream& os) const
+void DoubleCell::render(std::string& out) const
 {
-  if (trunc(get_double()) == get_double()) { // if sth like x.0 is printed
-    // print "x.0" instead of "x"
-    os << std::fixed << std::setprecision(1);
-  } else {
-    // print at most 6 sig fig as default
-    os << std::resetiosflags(std::ios::fixed) << std::setprecision(6);
-  }
-  os << get_double();
+  append_double(out, get_double());
 }
@@ -86,10 +86,10 @@ public:
   virtual Cell* floor() const;
   
   /**
-   * \brief Define the pure virtual print function to print the value stored in the cell.
+   * \brief Define the pure virtual render function to append the value stored in the cell.
    * \return void.
    */
-  virtual void print(std::ostream& os = std::cout) const;
+  virtual void render(std::string& out) const;
 
 private:
   double double_m;
@@ -0,0 +1,72 @@
+/**
+ * \file FutureCell.cpp
+ *
+ * The implementation details of FutureCell class member functions.
+ */
+
+#include "FutureCell.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+FutureCell::FutureCell(const Thunk& thunk)
+  :Cell(), state_m(STATE_PENDING), thunk_m(thunk), value_m(NULL), failed_m(false)
+{
+  
+}
+
+FutureCell::~FutureCell()
+{
+  
+}
+
+bool FutureCell::is_future() const
+{
+  return true;
+}
+
+void FutureCell::run()
+{
+  Thunk thunk;
+  {
+    lock_guard<mutex> lock(mutex_m);
+    if (state_m != STATE_PENDING) {
+      return;
+    }
+    state_m = STATE_RUNNING;
+    thunk.swap(thunk_m); // releases what the computation holds once done
+  }
+  Cell* value = NULL;
+  bool failed = false;
+  string error;
+  try {
+    value = thunk();
+  } catch (exception& e) {
+    failed = true;
+    error = e.what();
+  }
+  lock_guard<mutex> lock(mutex_m);
+  value_m = value;
+  failed_m = failed;
+  error_m = error;
+  state_m = STATE_DONE;
+  done_m.notify_all();
+}
+
+Cell* FutureCell::touch()
+{
+  run();
+  unique_lock<mutex> lock(mutex_m);
+  while (state_m != STATE_DONE) {
+    done_m.wait(lock);
+  }
+  if (failed_m) {
+    throw runtime_error(error_m);
+  }
+  return value_m;
+}
+
+void FutureCell::render(string& out) const
+{
+  out += "#<future>";
+}
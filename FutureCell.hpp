@@ -0,0 +1,80 @@
+/**
+ * \file FutureCell.hpp
+ *
+ * Interface of derived class FutureCell of abstract base class Cell
+ */
+
+#ifndef FUTURECELL_HPP
+#define FUTURECELL_HPP
+
+#include "Cell.hpp"
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+/**
+ * \class FutureCell
+ * \brief Derived class FutureCell. A value computed once, by whichever
+ * thread first runs or touches it.
+ */
+class FutureCell: public Cell {
+public:
+
+  /**
+   * \brief Type definition of the computation of the value.
+   */
+  typedef std::function<Cell*()> Thunk;
+  
+  /**
+   * \brief Constructor for initialising FutureCell class.
+   */
+  FutureCell(const Thunk& thunk);
+  
+  /**
+   * \brief Virtual distructor inherited from Cell class.
+   */
+  virtual ~FutureCell();
+  
+  /**
+   * \brief Override the default false return to true.
+   * \return True always.
+   */
+  virtual bool is_future() const;
+  
+  /**
+   * \brief Compute the value on the calling thread, unless another thread
+   * has already started to.
+   * \return Void.
+   */
+  void run();
+  
+  /**
+   * \brief Override the default error output to the value, computing it
+   * on the calling thread if no thread has started to, and waiting for it
+   * otherwise (error if the computation failed).
+   * \return The value of the future.
+   */
+  virtual Cell* touch();
+  
+  /**
+   * \brief Define the pure virtual render function to append the value stored in the cell.
+   * \return void.
+   */
+  virtual void render(std::string& out) const;
+
+private:
+  typedef enum e_state {STATE_PENDING, STATE_RUNNING, STATE_DONE} State;
+  
+  std::mutex mutex_m;
+  std::condition_variable done_m;
+  State state_m;
+  Thunk thunk_m;
+  Cell* value_m;
+  bool failed_m;
+  std::string error_m;
+
+};
+
+#endif // FUTURECELL_HPP
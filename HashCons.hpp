@@ -0,0 +1,92 @@
+/**
+ * \file HashCons.hpp
+ *
+ * Table used by the parser to share structurally equal cells.
+ */
+
+#ifndef HASHCONS_HPP
+#define HASHCONS_HPP
+
+#include "cons.hpp"
+#include "hashtablemap.hpp"
+#include <utility>
+
+/**
+ * \class HashConsKey
+ * \brief A parsed cell compared by value. The children of a list are shared
+ * before the list itself is looked up, so lists only compare the identity
+ * of their car and cdr.
+ */
+class HashConsKey {
+public:
+  HashConsKey(Cell* const c) : cell_m(c) {}
+
+  unsigned long hash() const
+  {
+    if (listp(cell_m)) {
+      return ((unsigned long) car(cell_m) >> 4) * 31 + ((unsigned long) cdr(cell_m) >> 4);
+    }
+    return cell_hash(cell_m);
+  }
+
+  bool operator== (const HashConsKey& k) const
+  {
+    if (listp(cell_m) && listp(k.cell_m)) {
+      return car(cell_m) == car(k.cell_m) && cdr(cell_m) == cdr(k.cell_m);
+    }
+    return !listp(cell_m) && !listp(k.cell_m) && cell_equal(cell_m, k.cell_m);
+  }
+
+private:
+  Cell* cell_m;
+};
+
+/**
+ * \class HashConsTable
+ * \brief Class HashConsTable. The set of distinct cells parsed so far.
+ */
+class HashConsTable {
+  
+public:
+
+  /**
+   * \brief Number of buckets, far more than DEFAULT_SIZE as every literal
+   * of a data file ends up in the table.
+   */
+  static const int TABLE_SIZE = 65521;
+
+  /**
+   * \brief Constructor of the HashConsTable.
+   */
+  HashConsTable() : map_m(TABLE_SIZE)
+  {
+    
+  }
+
+  /**
+   * \brief Share a freshly parsed cell with an equal one parsed before. The
+   * fresh cell is deleted when it is a duplicate.
+   * \return The shared cell equal to c.
+   */
+  Cell* share(Cell* const c)
+  {
+    if (nullp(c)) {
+      return c;
+    }
+    std::pair<hashtablemap<HashConsKey, Cell*>::iterator, bool> p
+      = map_m.insert(make_pair(HashConsKey(c), c));
+    if (!p.second) {
+      if (p.first->second != c) {
+	free_cell(c); // interned symbols are found as themselves and kept
+      }
+      return p.first->second;
+    }
+    return c;
+  }
+
+private:
+  hashtablemap<HashConsKey, Cell*> map_m;
+  
+};
+
+#endif // HASHCONS_HPP
@@ -5,8 +5,8 @@
  */
 
 #include "IntCell.hpp"
+#include "number.hpp"
 #include <iostream>
-#include <iomanip>
 
 IntCell::IntCell(const int i)
   :Cell(), int_m(i)
@@ -57,7 +57,7 @@ void IntCell::divide_from(bool& is_int, double& cum_quotient) const
   cum_quotient /= get_int();
 }
 
-void IntCell::print(std::ostream& os) const
+void IntCell::render(std::string& out) const
 {
-  os << get_int();
+  append_int(out, get_int());
 }
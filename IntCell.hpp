@@ -74,10 +74,10 @@ public:
   virtual void divide_from(bool& is_int, double& cum_quotient) const;
   
   /**
-   * \brief Define the pure virtual print function to print the value stored in the cell.
+   * \brief Define the pure virtual render function to append the value stored in the cell.
    * \return void.
    */
-  virtual void print(std::ostream& os = std::cout) const;
+  virtual void render(std::string& out) const;
   
 private:
   int int_m;
@@ -0,0 +1,321 @@
+/**
+ * \file Interpreter.hpp
+ *
+ * Encapsulates the state of one interpreter instance. Independent instances
+ * share nothing but immutable cells, so each may run on its own thread.
+ *
+ * The heap counters and the profiler switches stay per process, and the
+ * budget of the running expression per thread. Cells are made and freed by
+ * the cons.hpp factories, which have no instance at hand, and they outlive
+ * and move between the instances of pmap, future and --jobs.
+ */
+
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+
+#include "cons.hpp"
+#include "RefDict.hpp"
+#include "HashCons.hpp"
+#include "OutBuffer.hpp"
+#include "budget.hpp"
+#include <iostream>
+#include <vector>
+
+/**
+ * \brief Default of the deepest nesting of eval() an interpreter allows.
+ */
+const int DEFAULT_MAX_DEPTH = 100000;
+
+/**
+ * \class Interpreter
+ * \brief Class Interpreter. Owns the global scope, the stack of active
+ * scopes and arguments, the parser tables and the output streams that
+ * parse() and eval() work on.
+ */
+class Interpreter {
+  
+public:
+
+  /**
+   * \brief Type definition of the stack of active scopes, global first
+   */
+  typedef vector<RefDict*> RefStack;
+
+  /**
+   * \brief Type definition of the stack of evaluated call arguments
+   */
+  typedef vector<Cell*> ArgStack;
+
+  /**
+   * \brief Type definition of a snapshot of the global scope
+   */
+  typedef RefDict::RefMap Snapshot;
+
+  /**
+   * \brief Constructor of the Interpreter, printing results to out and
+   * errors to err.
+   */
+  Interpreter(ostream& out = cout, ostream& err = cerr)
+    : global_ref_m(RefDict::SCOPE_GLOBAL), out_m(&out), err_m(&err), out_buffer_m(out),
+      hashcons_m(NULL),
+      pure_m(false), transactional_m(false), depth_m(0), max_depth_m(DEFAULT_MAX_DEPTH)
+  {
+    ref_stack_m.push_back(&global_ref_m);
+  }
+
+  /**
+   * \brief Constructor of an Interpreter starting from a copy of every
+   * definition visible in proto, local ones included, printing to out and
+   * err. Definitions made in either interpreter afterwards are not seen by
+   * the other; the cells themselves are immutable and shared. The global
+   * scope starts as a snapshot of the one of proto, so only the local
+   * definitions are copied.
+   */
+  Interpreter(const Interpreter& proto, ostream& out, ostream& err)
+    : global_ref_m(proto.global_ref_m), out_m(&out), err_m(&err), out_buffer_m(out),
+      hashcons_m(NULL),
+      pure_m(proto.pure_m), transactional_m(proto.transactional_m),
+      depth_m(0), max_depth_m(proto.max_depth_m), limits_m(proto.limits_m)
+  {
+    for (RefStack::size_type i = 1; i < proto.ref_stack_m.size(); ++i) {
+      RefDict* frame = proto.ref_stack_m[i];
+      for (RefDict::RefIter it = frame->begin(); it != frame->end(); ++it) {
+	global_ref_m.assign(it->first, it->second);
+      }
+    }
+    ref_stack_m.push_back(&global_ref_m);
+    set_hashcons(proto.hashcons_m != NULL);
+  }
+
+  /**
+   * \brief Accessor. Writing to the stream only reads it, so any number of
+   * threads may share it.
+   * \return A stream discarding whatever is written to it, for the
+   * interpreters of parallel evaluations, which cannot print and may
+   * outlive the streams of the one that started them.
+   */
+  static ostream& discard()
+  {
+    struct DiscardBuffer: public streambuf {
+      int overflow(int c)
+      {
+	return traits_type::not_eof(c);
+      }
+    };
+    static DiscardBuffer buffer;
+    static ostream stream(&buffer);
+    return stream;
+  }
+
+  /**
+   * \brief Destructor of the Interpreter.
+   */
+  ~Interpreter()
+  {
+    delete hashcons_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The global scope.
+   */
+  RefDict& global_env()
+  {
+    return global_ref_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The stack of active scopes.
+   */
+  RefStack& ref_stack()
+  {
+    return ref_stack_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The stack of evaluated call arguments.
+   */
+  ArgStack& arg_stack()
+  {
+    return arg_stack_m;
+  }
+
+  /**
+   * \brief Accessor. The results printed into the buffer so far are
+   * written first, to come before whatever is written to the stream.
+   * \return The stream results are printed to.
+   */
+  ostream& out()
+  {
+    out_buffer_m.drain();
+    return *out_m;
+  }
+
+  /**
+   * \brief Accessor. The results printed into the buffer so far are
+   * flushed first, to come before the error.
+   * \return The stream errors are printed to.
+   */
+  ostream& err()
+  {
+    out_buffer_m.flush();
+    return *err_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The buffer results are printed into, flushed to out() at the
+   * end of the input, at each prompt, and by flush.
+   */
+  OutBuffer& out_buffer()
+  {
+    return out_buffer_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The parser's hash-consing table, NULL when hash-consing is off.
+   */
+  HashConsTable* hashcons()
+  {
+    return hashcons_m;
+  }
+
+  /**
+   * \brief Turn hash-consing of parsed cells on or off. When on,
+   * structurally equal ints, doubles, symbols and lists produced by parse()
+   * share a single cell (off by default).
+   * \return Void.
+   */
+  void set_hashcons(bool on)
+  {
+    if (on && hashcons_m == NULL) {
+      hashcons_m = new HashConsTable();
+    } else if (!on) {
+      delete hashcons_m;
+      hashcons_m = NULL;
+    }
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Whether define and print are rejected, as in code run by
+   * pmap, preduce or future.
+   */
+  bool pure() const
+  {
+    return pure_m;
+  }
+
+  /**
+   * \brief Reject (on) or allow (off) define and print.
+   * \return The previous setting.
+   */
+  bool set_pure(bool on)
+  {
+    bool was = pure_m;
+    pure_m = on;
+    return was;
+  }
+
+  /**
+   * \brief Take a snapshot of the global scope, in constant time.
+   * \return The global definitions as they are now.
+   */
+  Snapshot snapshot() const
+  {
+    return global_ref_m.snapshot();
+  }
+
+  /**
+   * \brief Bring back the global definitions of snapshot, in constant
+   * time, undoing any made since it was taken.
+   * \return Void.
+   */
+  void rollback(const Snapshot& snapshot)
+  {
+    global_ref_m.restore(snapshot);
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Whether a top-level expression that fails leaves the global
+   * scope as it was before the expression.
+   */
+  bool transactional() const
+  {
+    return transactional_m;
+  }
+
+  /**
+   * \brief Roll back the global scope after a failed top-level expression
+   * (on) or keep what it defined before failing (off, the default).
+   * \return Void.
+   */
+  void set_transactional(bool on)
+  {
+    transactional_m = on;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The number of calls of eval() running now, nested in one
+   * another.
+   */
+  int& depth()
+  {
+    return depth_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The deepest nesting of eval() allowed before it fails.
+   */
+  int max_depth() const
+  {
+    return max_depth_m;
+  }
+
+  /**
+   * \brief Let eval() nest at most max deep (DEFAULT_MAX_DEPTH by
+   * default); it fails beyond that, or wherever the stack of its thread is
+   * about to run out.
+   * \return Void.
+   */
+  void set_max_depth(int max)
+  {
+    max_depth_m = max;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The budget every top-level expression evaluated gets, none by
+   * default.
+   */
+  Limits& limits()
+  {
+    return limits_m;
+  }
+
+private:
+  Interpreter(const Interpreter&);
+  Interpreter& operator= (const Interpreter&);
+  
+  RefDict global_ref_m;
+  RefStack ref_stack_m;
+  ArgStack arg_stack_m;
+  ostream* out_m;
+  ostream* err_m;
+  OutBuffer out_buffer_m;
+  HashConsTable* hashcons_m;
+  bool pure_m;
+  bool transactional_m;
+  int depth_m;
+  int max_depth_m;
+  Limits limits_m;
+  
+};
+
+#endif // INTERPRETER_HPP
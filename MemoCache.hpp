@@ -0,0 +1,202 @@
+/**
+ * \file MemoCache.hpp
+ *
+ * Bounded result cache of a memoized procedure. Results are keyed by the
+ * structure of the evaluated arguments and evicted in least recently used
+ * order once the cache is full.
+ */
+
+#ifndef MEMOCACHE_HPP
+#define MEMOCACHE_HPP
+
+#include "cons.hpp"
+#include "hashtablemap.hpp"
+#include <list>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+/**
+ * \class MemoKey
+ * \brief The evaluated arguments of a single call, hashed and compared
+ * structurally.
+ */
+class MemoKey {
+  
+public:
+
+  /**
+   * \brief Type definition of the vector holding the arguments
+   */
+  typedef vector<Cell*> ArgVector;
+
+  /**
+   * \brief Constructor taking the arguments in [first, last).
+   */
+  MemoKey(ArgVector::const_iterator first, ArgVector::const_iterator last)
+    : args_m(first, last), hash_m(args_m.size())
+  {
+    for (ArgVector::const_iterator it = args_m.begin(); it != args_m.end(); ++it) {
+      hash_m = hash_m * 31 + cell_hash(*it);
+    }
+  }
+
+  /**
+   * \brief Accessor used by hashtablemap.
+   * \return The precomputed hash of the arguments.
+   */
+  unsigned long hash() const
+  {
+    return hash_m;
+  }
+
+  /**
+   * \brief Overloading the == operator for structural comparison.
+   * \return True iff both keys hold equal arguments.
+   */
+  bool operator== (const MemoKey& k) const
+  {
+    if (hash_m != k.hash_m || args_m.size() != k.args_m.size()) {
+      return false;
+    }
+    for (ArgVector::size_type i = 0; i < args_m.size(); ++i) {
+      if (!cell_equal(args_m[i], k.args_m[i])) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  ArgVector args_m;
+  unsigned long hash_m;
+  
+};
+
+/**
+ * \class MemoCache
+ * \brief Class MemoCache. A size-bounded map from arguments to the result of
+ * a pure procedure, with hit and miss counters.
+ */
+class MemoCache {
+  
+public:
+
+  /**
+   * \brief Number of results kept when no capacity is given.
+   */
+  static const int DEFAULT_CAPACITY = 1024;
+
+  /**
+   * \brief Constructor of the MemoCache.
+   */
+  MemoCache(int capacity = DEFAULT_CAPACITY)
+    : capacity_m(capacity), size_m(0), hits_m(0), misses_m(0)
+  {
+    
+  }
+
+  /**
+   * \brief Look up the result cached for key and mark it as most recently
+   * used.
+   * \return True on a hit, in which case value holds the result.
+   */
+  bool find(const MemoKey& key, Cell*& value)
+  {
+    lock_guard<mutex> lock(mutex_m);
+    MemoMap::iterator it = map_m.find(key);
+    if (it == map_m.end()) {
+      ++misses_m;
+      return false;
+    }
+    ++hits_m;
+    lru_m.splice(lru_m.begin(), lru_m, it->second.lru_pos);
+    value = it->second.value;
+    return true;
+  }
+
+  /**
+   * \brief Cache value as the result for key, evicting the least recently
+   * used result if the cache is full.
+   * \return Void.
+   */
+  void insert(const MemoKey& key, Cell* const value)
+  {
+    lock_guard<mutex> lock(mutex_m);
+    std::pair<MemoMap::iterator, bool> p = map_m.insert(make_pair(key, Entry()));
+    if (!p.second) {
+      lru_m.splice(lru_m.begin(), lru_m, p.first->second.lru_pos);
+      p.first->second.value = value;
+      return;
+    }
+    lru_m.push_front(&p.first->first);
+    p.first->second.value = value;
+    p.first->second.lru_pos = lru_m.begin();
+    if (++size_m > capacity_m) {
+      const MemoKey* victim = lru_m.back();
+      lru_m.pop_back();
+      map_m.erase(*victim);
+      --size_m;
+    }
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Number of calls answered from the cache.
+   */
+  long hits() const
+  {
+    lock_guard<mutex> lock(mutex_m);
+    return hits_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Number of calls that had to be evaluated.
+   */
+  long misses() const
+  {
+    lock_guard<mutex> lock(mutex_m);
+    return misses_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Number of results currently cached.
+   */
+  int size() const
+  {
+    lock_guard<mutex> lock(mutex_m);
+    return size_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Maximum number of results cached.
+   */
+  int capacity() const
+  {
+    return capacity_m;
+  }
+
+private:
+  typedef list<const MemoKey*> LruList;
+  
+  struct Entry {
+    Cell* value;
+    LruList::iterator lru_pos;
+  };
+  
+  typedef hashtablemap<MemoKey, Entry> MemoMap;
+  
+  MemoMap map_m;
+  LruList lru_m; // most recently used first
+  int capacity_m;
+  int size_m;
+  long hits_m;
+  long misses_m;
+  mutable mutex mutex_m; // interpreters on several threads share the cache
+  
+};
+
+#endif // MEMOCACHE_HPP
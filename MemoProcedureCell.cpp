@@ -0,0 +1,31 @@
+/**
+ * \file MemoProcedureCell.cpp
+ *
+ * The implementation details of MemoProcedureCell class member functions.
+ */
+
+#include "MemoProcedureCell.hpp"
+#include "MemoCache.hpp"
+
+using namespace std;
+
+MemoProcedureCell::MemoProcedureCell(Cell* const my_formals, Cell* const my_body, const int capacity)
+  :ProcedureCell(my_formals, my_body), memo_m(new MemoCache(capacity))
+{
+  
+}
+
+MemoProcedureCell::~MemoProcedureCell()
+{
+  delete memo_m;
+}
+
+bool MemoProcedureCell::is_memoized() const
+{
+  return true;
+}
+
+MemoCache* MemoProcedureCell::get_memo() const
+{
+  return memo_m;
+}
@@ -0,0 +1,51 @@
+/**
+ * \file MemoProcedureCell.hpp
+ *
+ * Interface of derived class MemoProcedureCell of class ProcedureCell
+ */
+
+#ifndef MEMOPROCEDURECELL_HPP
+#define MEMOPROCEDURECELL_HPP
+
+#include "ProcedureCell.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * \class MemoProcedureCell
+ * \brief Derived class MemoProcedureCell. A procedure whose results are
+ * cached by argument value, for pure procedures only.
+ */
+class MemoProcedureCell: public ProcedureCell {
+public:
+  
+  /**
+   * \brief Constructor for initialising MemoProcedureCell class.
+   */
+  MemoProcedureCell(Cell* const my_formals, Cell* const my_body, const int capacity);
+  
+  /**
+   * \brief Virtual distructor inherited from ProcedureCell class.
+   */
+  virtual ~MemoProcedureCell();
+  
+  /**
+   * \brief Override the default false return to true.
+   * \return True always.
+   */
+  virtual bool is_memoized() const;
+  
+  /**
+   * \brief Override the default error output to the cache of the procedure.
+   * \return The result cache.
+   */
+  virtual MemoCache* get_memo() const;
+
+private:
+  MemoCache* memo_m;
+
+};
+
+#endif // MEMOPROCEDURECELL_HPP
@@ -0,0 +1,59 @@
+/**
+ * \file NativeProcedureCell.cpp
+ *
+ * The implementation details of NativeProcedureCell class member functions.
+ */
+
+#include "NativeProcedureCell.hpp"
+#include <iostream>
+
+using namespace std;
+
+NativeProcedureCell::NativeProcedureCell(Cell* const my_name, Function my_function,
+					 int my_min_args, int my_max_args, void* my_data)
+  :Cell(), name_m(my_name), function_m(my_function),
+   min_args_m(my_min_args), max_args_m(my_max_args), data_m(my_data)
+{
+
+}
+
+NativeProcedureCell::~NativeProcedureCell()
+{
+
+}
+
+bool NativeProcedureCell::is_native() const
+{
+  return true;
+}
+
+Cell* NativeProcedureCell::get_name() const
+{
+  return name_m;
+}
+
+void NativeProcedureCell::set_name(Cell* const name)
+{
+  Cell* unnamed = NULL;
+  name_m.compare_exchange_strong(unnamed, name);
+}
+
+int NativeProcedureCell::min_args() const
+{
+  return min_args_m;
+}
+
+int NativeProcedureCell::max_args() const
+{
+  return max_args_m;
+}
+
+Cell* NativeProcedureCell::call(Interpreter& interp, Cell* const argv[], int argc) const
+{
+  return function_m(interp, argv, argc, data_m);
+}
+
+void NativeProcedureCell::render(string& out) const
+{
+  out += "#<function>";
+}
@@ -0,0 +1,102 @@
+/**
+ * \file NativeProcedureCell.hpp
+ *
+ * Interface of derived class NativeProcedureCell of abstract base class Cell
+ */
+
+#ifndef NATIVEPROCEDURECELL_HPP
+#define NATIVEPROCEDURECELL_HPP
+
+#include "Cell.hpp"
+#include <atomic>
+#include <iostream>
+
+class Interpreter;
+
+/**
+ * \class NativeProcedureCell
+ * \brief Derived class NativeProcedureCell. A procedure implemented by a
+ * C++ function of the program embedding the interpreter. It is applied
+ * like any procedure, and receives its arguments already evaluated, as an
+ * array.
+ */
+class NativeProcedureCell: public Cell {
+public:
+
+  /**
+   * \brief Type definition of the C++ function: it receives the argc
+   * evaluated arguments in argv, and the data given when it was defined.
+   */
+  typedef Cell* (*Function)(Interpreter& interp, Cell* const argv[], int argc, void* data);
+
+  /**
+   * \brief The maximum number of arguments of a function taking any
+   * number of them.
+   */
+  static const int VARIADIC = -1;
+
+  /**
+   * \brief Constructor for initialising NativeProcedureCell class.
+   */
+  NativeProcedureCell(Cell* const my_name, Function my_function,
+		      int my_min_args, int my_max_args, void* my_data);
+
+  /**
+   * \brief Virtual distructor inherited from Cell class.
+   */
+  virtual ~NativeProcedureCell();
+
+  /**
+   * \brief Override the default false return to true.
+   * \return True always.
+   */
+  virtual bool is_native() const;
+
+  /**
+   * \brief Override the default error output to the name of the procedure.
+   * \return The symbol the procedure was defined as.
+   */
+  virtual Cell* get_name() const;
+
+  /**
+   * \brief Override the default error output to name the procedure, if
+   * it was made without a name. Only the first name given is kept, also
+   * when interpreters on other threads name it at the same time.
+   * \return Void.
+   */
+  virtual void set_name(Cell* const name);
+
+  /**
+   * \brief Accessor.
+   * \return The least number of arguments taken.
+   */
+  int min_args() const;
+
+  /**
+   * \brief Accessor.
+   * \return The most arguments taken, VARIADIC if there is no limit.
+   */
+  int max_args() const;
+
+  /**
+   * \brief Call the function with argc evaluated arguments, whose number
+   * the caller has checked.
+   * \return The result of the function.
+   */
+  Cell* call(Interpreter& interp, Cell* const argv[], int argc) const;
+
+  /**
+   * \brief Define the pure virtual render function to append the value stored in the cell.
+   * \return void.
+   */
+  virtual void render(std::string& out) const;
+
+private:
+  std::atomic<Cell*> name_m;
+  Function function_m;
+  int min_args_m;
+  int max_args_m;
+  void* data_m;
+};
+
+#endif // NATIVEPROCEDURECELL_HPP
@@ -0,0 +1,98 @@
+/**
+ * \file OutBuffer.hpp
+ *
+ * Encapsulates the buffer results are printed into before they are
+ * written to the output stream.
+ */
+
+#ifndef OUTBUFFER_HPP
+#define OUTBUFFER_HPP
+
+#include "Cell.hpp"
+#include <iostream>
+#include <string>
+
+/**
+ * \class OutBuffer
+ * \brief Class OutBuffer. Collects the printed results in one reusable
+ * string, and writes them to the stream in large blocks: whenever
+ * FLUSH_SIZE bytes have collected, and at the flush points, where the
+ * stream itself is flushed too.
+ */
+class OutBuffer {
+
+public:
+
+  /**
+   * \brief Number of bytes collected before they are written.
+   */
+  static const std::string::size_type FLUSH_SIZE = 1 << 16;
+
+  /**
+   * \brief Constructor of an OutBuffer writing to os.
+   */
+  explicit OutBuffer(std::ostream& os)
+    : os_m(&os)
+  {
+    buffer_m.reserve(FLUSH_SIZE);
+  }
+
+  /**
+   * \brief Destructor, flushing what is left.
+   */
+  ~OutBuffer()
+  {
+    flush();
+  }
+
+  /**
+   * \brief Append the subtree rooted at c in s-expression notation, "()"
+   * for nil, and end the line.
+   * \return Void.
+   */
+  void print_line(const Cell* const c)
+  {
+    if (c == nil) {
+      buffer_m += "()";
+    } else {
+      c->render(buffer_m);
+    }
+    buffer_m += '\n';
+    if (buffer_m.size() >= FLUSH_SIZE) {
+      drain();
+    }
+  }
+
+  /**
+   * \brief Write what has collected to the stream, without flushing it, so
+   * that something written to the stream directly comes after it.
+   * \return Void.
+   */
+  void drain()
+  {
+    if (!buffer_m.empty()) {
+      os_m->write(buffer_m.data(), buffer_m.size());
+      buffer_m.clear();
+    }
+  }
+
+  /**
+   * \brief Write what has collected to the stream, and flush the stream.
+   * \return Void.
+   */
+  void flush()
+  {
+    drain();
+    os_m->flush();
+  }
+
+private:
+  OutBuffer(const OutBuffer&);
+  OutBuffer& operator= (const OutBuffer&);
+
+  std::ostream* os_m;
+  std::string buffer_m;
+
+};
+
+#endif // OUTBUFFER_HPP
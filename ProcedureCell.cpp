@@ -10,7 +10,7 @@
 using namespace std;
 
 ProcedureCell::ProcedureCell(Cell* const my_formals, Cell* const my_body)
-  :Cell(), formals_m(my_formals), body_m(my_body)
+  :Cell(), formals_m(my_formals), body_m(my_body), name_m(NULL)
 {
   
 }
@@ -35,7 +35,18 @@ Cell* ProcedureCell::get_body() const
   return body_m;
 }
 
-void ProcedureCell::print(ostream& os) const
+Cell* ProcedureCell::get_name() const
 {
-  os << "#<function>";
+  return name_m;
+}
+
+void ProcedureCell::set_name(Cell* const name)
+{
+  Cell* unnamed = NULL;
+  name_m.compare_exchange_strong(unnamed, name);
+}
+
+void ProcedureCell::render(string& out) const
+{
+  out += "#<function>";
 }
@@ -8,6 +8,7 @@
 #define PROCEDURECELL_HPP
 
 #include "Cell.hpp"
+#include <atomic>
 #include <cstddef>
 #include <cstdlib>
 #include <iostream>
@@ -49,14 +50,29 @@ public:
   virtual Cell* get_body() const;
   
   /**
-   * \brief Define the pure virtual print function to print the value stored in the cell.
+   * \brief Override the default error output to the name of the procedure.
+   * \return The symbol the procedure was first defined as, nil if none.
+   */
+  virtual Cell* get_name() const;
+  
+  /**
+   * \brief Override the default error output to name the procedure, once.
+   * Interpreters on other threads may define the same procedure, and only
+   * the first name given is kept.
+   * \return Void.
+   */
+  virtual void set_name(Cell* const name);
+  
+  /**
+   * \brief Define the pure virtual render function to append the value stored in the cell.
    * \return void.
    */
-  virtual void print(std::ostream& os = std::cout) const;
+  virtual void render(std::string& out) const;
 
 private:
   Cell* formals_m;
   Cell* body_m;
+  std::atomic<Cell*> name_m;
 
 };
 
@@ -1,5 +1,14 @@
-#include "Cell.hpp"
-#include "hashtablemap.hpp"
+/**
+ * \file RefDict.hpp
+ *
+ * Symbol table of a single scope of the evaluator.
+ */
+
+#ifndef REFDICT_HPP
+#define REFDICT_HPP
+
+#include "cons.hpp"
+#include "hamtmap.hpp"
 #include <map>
 #include <utility>
 #include <stdexcept>
@@ -7,16 +16,17 @@
 /**
  * \class RefDict
  * \brief Class RefDict. A class containing the map storing the defined symbol of the scheme
- * function.
+ * function. The map is persistent, so copying a RefDict, or taking a
+ * snapshot of it, takes constant time and shares the bindings.
  */
 class RefDict {
   
 public:
 
   /**
-   * \brief Type definition of map with string key and Cell* value
+   * \brief Type definition of persistent map with string key and Cell* value
    */
-  typedef hashtablemap<string, Cell*> RefMap;
+  typedef hamtmap<string, Cell*> RefMap;
 
   /**
    * \brief Type definition of pair with string key and Cell* value
@@ -40,31 +50,42 @@ public:
   RefDict(Scope scope = SCOPE_LOCAL)
   {
     if (scope == SCOPE_GLOBAL) {
-      map_m["+"] = new SymbolCell("+");
-      map_m["-"] = new SymbolCell("-");
-      map_m["*"] = new SymbolCell("*");
-      map_m["/"] = new SymbolCell("/");
-      map_m["ceiling"] = new SymbolCell("ceiling");
-      map_m["floor"] = new SymbolCell("floor");
-      map_m["quote"] = new SymbolCell("quote");
-      map_m["if"] = new SymbolCell("if");
-      map_m["cons"] = new SymbolCell("cons");
-      map_m["car"] = new SymbolCell("car");
-      map_m["cdr"] = new SymbolCell("cdr");
-      map_m["nullp"] = new SymbolCell("nullp");
-      map_m["symbolp"] = new SymbolCell("symbolp");
-      map_m["intp"] = new SymbolCell("intp");
-      map_m["doublep"] = new SymbolCell("doublep");
-      map_m["listp"] = new SymbolCell("listp");
-      map_m["procedurep"] = new SymbolCell("procedurep");
-      map_m["define"] = new SymbolCell("define");
-      map_m["<"] = new SymbolCell("<");
-      map_m["not"] = new SymbolCell("not");
-      map_m["print"] = new SymbolCell("print");
-      map_m["eval"] = new SymbolCell("eval");
-      map_m["lambda"] = new SymbolCell("lambda");
-      map_m["apply"] = new SymbolCell("apply");
-      map_m["let"] = new SymbolCell("let");
+      map_m.assign("+", make_symbol("+"));
+      map_m.assign("-", make_symbol("-"));
+      map_m.assign("*", make_symbol("*"));
+      map_m.assign("/", make_symbol("/"));
+      map_m.assign("ceiling", make_symbol("ceiling"));
+      map_m.assign("floor", make_symbol("floor"));
+      map_m.assign("quote", make_symbol("quote"));
+      map_m.assign("if", make_symbol("if"));
+      map_m.assign("cons", make_symbol("cons"));
+      map_m.assign("car", make_symbol("car"));
+      map_m.assign("cdr", make_symbol("cdr"));
+      map_m.assign("nullp", make_symbol("nullp"));
+      map_m.assign("symbolp", make_symbol("symbolp"));
+      map_m.assign("intp", make_symbol("intp"));
+      map_m.assign("doublep", make_symbol("doublep"));
+      map_m.assign("listp", make_symbol("listp"));
+      map_m.assign("procedurep", make_symbol("procedurep"));
+      map_m.assign("define", make_symbol("define"));
+      map_m.assign("<", make_symbol("<"));
+      map_m.assign("not", make_symbol("not"));
+      map_m.assign("print", make_symbol("print"));
+      map_m.assign("eval", make_symbol("eval"));
+      map_m.assign("lambda", make_symbol("lambda"));
+      map_m.assign("apply", make_symbol("apply"));
+      map_m.assign("let", make_symbol("let"));
+      map_m.assign("memoize", make_symbol("memoize"));
+      map_m.assign("memo-stats", make_symbol("memo-stats"));
+      map_m.assign("write-binary", make_symbol("write-binary"));
+      map_m.assign("read-binary", make_symbol("read-binary"));
+      map_m.assign("pmap", make_symbol("pmap"));
+      map_m.assign("future", make_symbol("future"));
+      map_m.assign("touch", make_symbol("touch"));
+      map_m.assign("preduce", make_symbol("preduce"));
+      map_m.assign("profile-report", make_symbol("profile-report"));
+      map_m.assign("heap-stats", make_symbol("heap-stats"));
+      map_m.assign("flush", make_symbol("flush"));
     }
   }
 
@@ -147,6 +168,33 @@ public:
     return p.first;
   }
 
+  /**
+   * \brief Bind a string as a key to c, replacing any previous binding
+   * \return Void.
+   */
+  void assign(const string& s, Cell* const c)
+  {
+    map_m.assign(s, c);
+  }
+
+  /**
+   * \brief Take a snapshot of the bindings, in constant time.
+   * \return The bindings as they are now.
+   */
+  RefMap snapshot() const
+  {
+    return map_m;
+  }
+
+  /**
+   * \brief Bring back the bindings of a snapshot, in constant time.
+   * \return Void.
+   */
+  void restore(const RefMap& snapshot)
+  {
+    map_m = snapshot;
+  }
+
   /**
    * \brief Get the size of map.
    * \return An integer storing the size.
@@ -185,3 +233,5 @@ private:
   RefMap map_m;
   
 };
+
+#endif // REFDICT_HPP
@@ -5,20 +5,29 @@
  */
 
 #include "SymbolCell.hpp"
+#include "SymbolTable.hpp"
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
 SymbolCell::SymbolCell(const char* const s)
-  :Cell(), symbol_m(strdup(s))
+  :Cell(), symbol_m(strdup(s)), hash_m(SymbolTable::hash(s))
 {
   
 }
 
-SymbolCell::~SymbolCell()
+SymbolCell::SymbolCell(const char* const s, const unsigned long hash)
+  :Cell(), symbol_m(strdup(s)), hash_m(hash)
 {
+  
+}
 
+SymbolCell::~SymbolCell()
+{
+  free(symbol_m);
 }
 
 bool SymbolCell::is_symbol() const
@@ -31,7 +40,17 @@ string SymbolCell::get_symbol() const
   return symbol_m;
 }
 
-void SymbolCell::print(ostream& os) const
+unsigned long SymbolCell::get_symbol_hash() const
+{
+  return hash_m;
+}
+
+const char* SymbolCell::symbol() const
+{
+  return symbol_m;
+}
+
+void SymbolCell::render(string& out) const
 {
-  os << get_symbol();
+  out += symbol_m;
 }
@@ -25,6 +25,12 @@ public:
    */
   SymbolCell(const char* const s);
   
+  /**
+   * \brief Constructor for initialising SymbolCell class with the hash of
+   * s already known.
+   */
+  SymbolCell(const char* const s, const unsigned long hash);
+  
   /**
    * \brief Virtual distructor inherited from Cell class.
    */
@@ -43,13 +49,27 @@ public:
   virtual std::string get_symbol() const;
   
   /**
-   * \brief Define the pure virtual print function to print the value stored in the cell.
+   * \brief Override the default error output to the hash of the symbol,
+   * computed once on construction.
+   * \return The hash of the symbol name.
+   */
+  virtual unsigned long get_symbol_hash() const;
+  
+  /**
+   * \brief Accessor.
+   * \return The symbol name, without copying it into a string.
+   */
+  const char* symbol() const;
+  
+  /**
+   * \brief Define the pure virtual render function to append the value stored in the cell.
    * \return void.
    */
-  virtual void print(std::ostream& os = std::cout) const;
+  virtual void render(std::string& out) const;
 
 private:
   char* symbol_m;
+  unsigned long hash_m;
 
 };
 
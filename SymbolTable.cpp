@@ -0,0 +1,108 @@
+/**
+ * \file SymbolTable.cpp
+ *
+ * The implementation details of SymbolTable class member functions.
+ */
+
+#include "SymbolTable.hpp"
+#include "heap.hpp"
+#include <cstring>
+
+using namespace std;
+
+SymbolTable& SymbolTable::instance()
+{
+  static SymbolTable table;
+  return table;
+}
+
+unsigned long SymbolTable::hash(const char* const s)
+{
+  // FNV-1a
+  unsigned long hash = 2166136261UL;
+  for (const char* p = s; *p != '\0'; ++p) {
+    hash = (hash ^ (unsigned char) *p) * 16777619UL;
+  }
+  return hash;
+}
+
+SymbolTable::SymbolTable()
+  : size_m(0)
+{
+  for (int i = 0; i < SHARDS; ++i) {
+    shards_m[i].buckets.store(make_buckets(INITIAL_BUCKETS), memory_order_relaxed);
+    shards_m[i].size = 0;
+  }
+}
+
+SymbolTable::Buckets* SymbolTable::make_buckets(unsigned long n)
+{
+  Buckets* b = new Buckets();
+  b->mask = n - 1;
+  b->heads = new atomic<Node*>[n];
+  for (unsigned long i = 0; i < n; ++i) {
+    b->heads[i].store(NULL, memory_order_relaxed);
+  }
+  return b;
+}
+
+SymbolCell* SymbolTable::find(Buckets* b, const char* const s, unsigned long hash)
+{
+  // the low bits chose the shard, so the bucket uses the ones above them
+  Node* node = b->heads[(hash / SHARDS) & b->mask].load(memory_order_acquire);
+  for (; node != NULL; node = node->next) {
+    if (node->hash == hash && strcmp(node->cell->symbol(), s) == 0) {
+      return node->cell;
+    }
+  }
+  return NULL;
+}
+
+SymbolCell* SymbolTable::intern(const char* const s)
+{
+  unsigned long h = hash(s);
+  Shard& shard = shards_m[h & (SHARDS - 1)];
+  SymbolCell* cell = find(shard.buckets.load(memory_order_acquire), s, h);
+  if (cell != NULL) {
+    return cell;
+  }
+
+  lock_guard<mutex> lock(shard.insert_mutex);
+  Buckets* b = shard.buckets.load(memory_order_relaxed);
+  // another thread may have added s since the lookup above
+  cell = find(b, s, h);
+  if (cell != NULL) {
+    return cell;
+  }
+  if ((unsigned long) shard.size > b->mask) {
+    // grow by rebuilding the chains in a new bucket array
+    Buckets* grown = make_buckets((b->mask + 1) * 2);
+    for (unsigned long i = 0; i <= b->mask; ++i) {
+      for (Node* node = b->heads[i].load(memory_order_relaxed); node != NULL; node = node->next) {
+	atomic<Node*>& head = grown->heads[(node->hash / SHARDS) & grown->mask];
+	Node* copy = new Node();
+	copy->cell = node->cell;
+	copy->hash = node->hash;
+	copy->next = head.load(memory_order_relaxed);
+	head.store(copy, memory_order_relaxed);
+      }
+    }
+    shard.buckets.store(grown, memory_order_release);
+    b = grown;
+  }
+  Node* node = new Node();
+  count_made(HEAP_SYMBOL, sizeof(SymbolCell) + strlen(s) + 1);
+  node->cell = new SymbolCell(s, h);
+  node->hash = h;
+  atomic<Node*>& head = b->heads[(h / SHARDS) & b->mask];
+  node->next = head.load(memory_order_relaxed);
+  head.store(node, memory_order_release);
+  ++shard.size;
+  ++size_m;
+  return node->cell;
+}
+
+long SymbolTable::size() const
+{
+  return size_m.load(memory_order_relaxed);
+}
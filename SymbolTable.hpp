@@ -0,0 +1,91 @@
+/**
+ * \file SymbolTable.hpp
+ *
+ * Interface of the process-wide table of interned symbols, shared by all
+ * interpreter threads.
+ */
+
+#ifndef SYMBOLTABLE_HPP
+#define SYMBOLTABLE_HPP
+
+#include "SymbolCell.hpp"
+#include <atomic>
+#include <mutex>
+
+/**
+ * \class SymbolTable
+ * \brief Class SymbolTable. Maps every symbol name to its one canonical
+ * SymbolCell. The table is split into shards by hash; looking a name up
+ * takes no lock, and adding a name only locks its shard.
+ */
+class SymbolTable {
+public:
+
+  /**
+   * \brief Number of shards, a power of two.
+   */
+  static const int SHARDS = 64;
+
+  /**
+   * \brief Number of buckets a shard starts with, a power of two.
+   */
+  static const int INITIAL_BUCKETS = 64;
+
+  /**
+   * \brief Accessor.
+   * \return The table shared by the whole process.
+   */
+  static SymbolTable& instance();
+
+  /**
+   * \brief Hash a symbol name, as cached in its SymbolCell.
+   * \return The hash value.
+   */
+  static unsigned long hash(const char* const s);
+
+  /**
+   * \brief Look up the canonical cell of the symbol s, creating it when s
+   * is seen for the first time.
+   * \return A pointer to the SymbolCell.
+   */
+  SymbolCell* intern(const char* const s);
+
+  /**
+   * \brief Accessor.
+   * \return Number of distinct symbols interned so far.
+   */
+  long size() const;
+
+private:
+  struct Node {
+    SymbolCell* cell;
+    unsigned long hash;
+    Node* next; // never changes once the node is reachable
+  };
+
+  // buckets are replaced, never freed, when a shard grows, as readers
+  // may still be walking them
+  struct Buckets {
+    unsigned long mask;
+    std::atomic<Node*>* heads;
+  };
+
+  struct Shard {
+    std::mutex insert_mutex;
+    std::atomic<Buckets*> buckets;
+    long size;
+  };
+
+  SymbolTable();
+  SymbolTable(const SymbolTable&);
+  SymbolTable& operator= (const SymbolTable&);
+
+  static Buckets* make_buckets(unsigned long n);
+  static SymbolCell* find(Buckets* b, const char* const s, unsigned long hash);
+
+  Shard shards_m[SHARDS];
+  std::atomic<long> size_m;
+
+};
+
+#endif // SYMBOLTABLE_HPP
@@ -0,0 +1,272 @@
+/**
+ * \file ThreadPool.hpp
+ *
+ * A fixed-size work-stealing thread pool. Every worker owns a queue; it
+ * takes work from the back of its own queue and steals from the front of
+ * the others' when its own runs dry.
+ */
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \class ThreadPool
+ * \brief Class ThreadPool. Runs batches of tasks on a fixed set of threads.
+ * The thread waiting for a batch keeps running queued tasks until the batch
+ * is done, so a task may itself run a nested batch on the same pool without
+ * deadlocking it.
+ */
+class ThreadPool {
+
+public:
+
+  /**
+   * \brief Type definition of a unit of work.
+   */
+  typedef function<void()> Task;
+
+  /**
+   * \brief Constructor of the ThreadPool. The thread calling run() takes
+   * part in the work, so threads - 1 background workers are started.
+   */
+  explicit ThreadPool(int threads)
+    : queued_m(0), next_m(0), stop_m(false)
+  {
+    int workers = threads > 1 ? threads - 1 : 0;
+    int queues = workers > 0 ? workers : 1;
+    for (int i = 0; i < queues; ++i) {
+      queues_m.push_back(new Queue());
+    }
+    for (int i = 0; i < workers; ++i) {
+      workers_m.push_back(thread(&ThreadPool::work, this, i));
+    }
+  }
+
+  /**
+   * \brief Destructor of the ThreadPool. Waits for the workers to finish
+   * their current task.
+   */
+  ~ThreadPool()
+  {
+    {
+      lock_guard<mutex> lock(idle_mutex_m);
+      stop_m = true;
+    }
+    idle_m.notify_all();
+    for (vector<thread>::size_type i = 0; i < workers_m.size(); ++i) {
+      workers_m[i].join();
+    }
+    for (vector<Queue*>::size_type i = 0; i < queues_m.size(); ++i) {
+      // submitted tasks nobody got to are dropped
+      for (deque<Job>::iterator it = queues_m[i]->jobs.begin(); it != queues_m[i]->jobs.end(); ++it) {
+	if (it->batch == NULL) {
+	  delete it->task;
+	}
+      }
+      delete queues_m[i];
+    }
+  }
+
+  /**
+   * \brief Number of threads working on a batch, including the caller.
+   * \return An integer storing the number of threads.
+   */
+  int threads() const
+  {
+    return workers_m.size() + 1;
+  }
+
+  /**
+   * \brief Run every task and return once all of them have finished. The
+   * first exception thrown by a task is rethrown here after the batch is
+   * done.
+   * \return Void.
+   */
+  void run(vector<Task>& tasks)
+  {
+    Batch batch(tasks.size());
+    for (vector<Task>::size_type i = 0; i < tasks.size(); ++i) {
+      push(Job(&tasks[i], &batch));
+    }
+    while (batch.remaining > 0) {
+      Job job;
+      if (take(job)) {
+	execute(job);
+      } else {
+	unique_lock<mutex> lock(batch.done_mutex);
+	batch.done.wait_for(lock, chrono::milliseconds(1));
+      }
+    }
+    // wait for the thread finishing the last task to let go of the batch
+    lock_guard<mutex> lock(batch.done_mutex);
+    if (batch.error) {
+      rethrow_exception(batch.error);
+    }
+  }
+
+  /**
+   * \brief Queue a task to be run by whichever thread gets to it first,
+   * without waiting for it. The task should not throw.
+   * \return Void.
+   */
+  void submit(const Task& task)
+  {
+    push(Job(new Task(task), NULL));
+  }
+
+private:
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator= (const ThreadPool&);
+
+  struct Batch {
+    Batch(int n) : remaining(n) {}
+    atomic<int> remaining;
+    mutex done_mutex;
+    condition_variable done;
+    exception_ptr error;
+  };
+
+  struct Job {
+    Job(Task* t = NULL, Batch* b = NULL) : task(t), batch(b) {}
+    Task* task;
+    Batch* batch;
+  };
+
+  struct Queue {
+    mutex m;
+    deque<Job> jobs;
+  };
+
+  /**
+   * \brief Index of the queue owned by the calling thread in this pool, -1
+   * for threads that are not workers of this pool.
+   */
+  int own_queue() const
+  {
+    return current_pool() == this ? current_index() : -1;
+  }
+
+  static const ThreadPool*& current_pool()
+  {
+    static thread_local const ThreadPool* pool = NULL;
+    return pool;
+  }
+
+  static int& current_index()
+  {
+    static thread_local int index = -1;
+    return index;
+  }
+
+  void push(const Job& job)
+  {
+    int q = own_queue();
+    if (q < 0) {
+      q = next_m++ % queues_m.size();
+    }
+    {
+      lock_guard<mutex> lock(queues_m[q]->m);
+      queues_m[q]->jobs.push_back(job);
+    }
+    {
+      lock_guard<mutex> lock(idle_mutex_m);
+      ++queued_m;
+    }
+    idle_m.notify_one();
+  }
+
+  bool take(Job& job)
+  {
+    int own = own_queue();
+    if (own >= 0) {
+      Queue* q = queues_m[own];
+      lock_guard<mutex> lock(q->m);
+      if (!q->jobs.empty()) {
+	job = q->jobs.back();
+	q->jobs.pop_back();
+	--queued_m;
+	return true;
+      }
+    }
+    int n = queues_m.size();
+    int start = own >= 0 ? own + 1 : 0;
+    for (int i = 0; i < n; ++i) {
+      Queue* q = queues_m[(start + i) % n];
+      lock_guard<mutex> lock(q->m);
+      if (!q->jobs.empty()) {
+	job = q->jobs.front();
+	q->jobs.pop_front();
+	--queued_m;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  void execute(Job& job)
+  {
+    if (job.batch == NULL) {
+      // a submitted task, owned by its job
+      try {
+	(*job.task)();
+      } catch (...) {
+      }
+      delete job.task;
+      return;
+    }
+    try {
+      (*job.task)();
+    } catch (...) {
+      lock_guard<mutex> lock(job.batch->done_mutex);
+      if (!job.batch->error) {
+	job.batch->error = current_exception();
+      }
+    }
+    // the batch may be destroyed as soon as the lock is released
+    lock_guard<mutex> lock(job.batch->done_mutex);
+    if (--job.batch->remaining == 0) {
+      job.batch->done.notify_all();
+    }
+  }
+
+  void work(int index)
+  {
+    current_pool() = this;
+    current_index() = index;
+    while (true) {
+      Job job;
+      if (take(job)) {
+	execute(job);
+	continue;
+      }
+      unique_lock<mutex> lock(idle_mutex_m);
+      idle_m.wait(lock, [this] { return stop_m || queued_m > 0; });
+      if (stop_m) {
+	return;
+      }
+    }
+  }
+
+  vector<Queue*> queues_m;
+  vector<thread> workers_m;
+  atomic<int> queued_m;
+  atomic<unsigned> next_m;
+  mutex idle_mutex_m;
+  condition_variable idle_m;
+  bool stop_m;
+
+};
+
+#endif // THREADPOOL_HPP
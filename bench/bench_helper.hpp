@@ -0,0 +1,79 @@
+/**
+ * \file bench_helper.hpp
+ *
+ * Helpers shared by the benchmarks for driving the interpreter.
+ */
+
+#ifndef BENCH_HELPER_HPP
+#define BENCH_HELPER_HPP
+
+#include "../cons.hpp"
+#include "../Interpreter.hpp"
+#include "../parse.hpp"
+#include "../eval.hpp"
+#include "../microlisp.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+/**
+ * \brief Parse and evaluate one s-expression.
+ * \return The value of the expression.
+ */
+inline Cell* eval_string(Interpreter& interp, const string& sexpr) throw (runtime_error)
+{
+  return eval(interp, parse(interp, sexpr));
+}
+
+/**
+ * \brief Evaluate every top-level expression of the file at path, such as
+ * library.scm (error if it cannot be read).
+ * \return Void.
+ */
+inline void load_file(Interpreter& interp, const char* path) throw (runtime_error)
+{
+  ifstream fin(path);
+  if (!fin) {
+    throw runtime_error(string("cannot read ") + path);
+  }
+  string sexpr;
+  int depth = 0;
+  char c;
+  while (fin.get(c)) {
+    if (c == ';' && depth == 0) {
+      string comment;
+      getline(fin, comment);
+      continue;
+    }
+    if (depth == 0 && iswhitespace(c)) {
+      continue;
+    }
+    sexpr += c;
+    if (c == '(') {
+      ++depth;
+    } else if (c == ')' && --depth == 0) {
+      eval_string(interp, sexpr);
+      sexpr.clear();
+    }
+  }
+}
+
+/**
+ * \brief Make a list of n pseudo-random ints below 2^15, the same for the
+ * same seed.
+ * \return The list.
+ */
+inline Cell* random_list(long n, unsigned long seed = 1)
+{
+  Cell* list = nil;
+  for (long i = 0; i < n; ++i) {
+    seed = seed * 1103515245UL + 12345UL;
+    list = cons(make_int((int) ((seed >> 16) & 0x7fff)), list);
+  }
+  return list;
+}
+
+#endif // BENCH_HELPER_HPP
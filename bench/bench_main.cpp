@@ -0,0 +1,9 @@
+/**
+ * \file bench_main.cpp
+ *
+ * Entry point of the benchmarks, running those of every file linked in.
+ */
+
+#include "benchmark.hpp"
+
+BENCHMARK_MAIN()
@@ -0,0 +1,582 @@
+/**
+ * \file benchmark.hpp
+ *
+ * A small benchmark harness modelled on Google Benchmark. A benchmark is a
+ * function taking a BenchState, registered with BENCHMARK(), which times
+ * the loop it runs while state.keep_running() holds:
+ *
+ *   void BM_parse(BenchState& state)
+ *   {
+ *     // setup, not timed
+ *     while (state.keep_running()) {
+ *       // timed
+ *     }
+ *   }
+ *   BENCHMARK(BM_parse)->Range(8, 512);
+ *
+ * The iterations are chosen so that each run lasts at least --min-time
+ * seconds, unless fixed by Iterations(). Results are printed as a table,
+ * or as JSON or CSV for tracking performance across commits. Benchmarks
+ * run on a thread with a large stack, as the evaluator recurses once per
+ * level of the lists it walks.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+/**
+ * \brief Stack size of the thread running the benchmarks.
+ */
+const size_t BENCH_STACK_SIZE = (size_t) 1 << 30;
+
+/**
+ * \class BenchState
+ * \brief Class BenchState. The state of one run of a benchmark: how many
+ * iterations are left, the argument it runs with, and its clocks.
+ */
+class BenchState {
+
+public:
+
+  /**
+   * \brief Constructor of the BenchState.
+   */
+  BenchState(long iterations, long arg)
+    : iterations_m(iterations), remaining_m(iterations), arg_m(arg),
+      items_m(0), started_m(false), running_m(false), real_ns_m(0), cpu_ns_m(0)
+  {
+
+  }
+
+  /**
+   * \brief Start the clocks on the first call, and stop them once all
+   * iterations are done.
+   * \return True iff another iteration should run.
+   */
+  bool keep_running()
+  {
+    if (!started_m) {
+      started_m = true;
+      resume_timing();
+    }
+    if (remaining_m > 0) {
+      --remaining_m;
+      return true;
+    }
+    if (running_m) {
+      pause_timing();
+    }
+    return false;
+  }
+
+  /**
+   * \brief Stop the clocks, to leave work out of the measurement.
+   * \return Void.
+   */
+  void pause_timing()
+  {
+    real_ns_m += real_now() - real_start_m;
+    cpu_ns_m += cpu_now() - cpu_start_m;
+    running_m = false;
+  }
+
+  /**
+   * \brief Restart the clocks stopped by pause_timing().
+   * \return Void.
+   */
+  void resume_timing()
+  {
+    real_start_m = real_now();
+    cpu_start_m = cpu_now();
+    running_m = true;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The argument the benchmark runs with.
+   */
+  long arg() const
+  {
+    return arg_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The number of iterations of the run.
+   */
+  long iterations() const
+  {
+    return iterations_m;
+  }
+
+  /**
+   * \brief Record the items processed over all iterations, to be reported
+   * per second.
+   * \return Void.
+   */
+  void set_items_processed(long items)
+  {
+    items_m = items;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The items processed over all iterations.
+   */
+  long items_processed() const
+  {
+    return items_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Wall-clock nanoseconds measured.
+   */
+  long long real_ns() const
+  {
+    return real_ns_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return CPU nanoseconds of the running thread measured.
+   */
+  long long cpu_ns() const
+  {
+    return cpu_ns_m;
+  }
+
+private:
+
+  static long long real_now()
+  {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static long long cpu_now()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  }
+
+  long iterations_m;
+  long remaining_m;
+  long arg_m;
+  long items_m;
+  bool started_m;
+  bool running_m;
+  long long real_start_m;
+  long long cpu_start_m;
+  long long real_ns_m;
+  long long cpu_ns_m;
+
+};
+
+/**
+ * \brief Type definition of a benchmark function.
+ */
+typedef void (*BenchFunction)(BenchState&);
+
+/**
+ * \class Benchmark
+ * \brief Class Benchmark. A registered benchmark function and the arguments
+ * it runs with. The setters return the benchmark so that they chain.
+ */
+class Benchmark {
+
+public:
+
+  /**
+   * \brief Constructor of the Benchmark.
+   */
+  Benchmark(const string& name, BenchFunction function)
+    : name_m(name), function_m(function), iterations_m(0)
+  {
+
+  }
+
+  /**
+   * \brief Run with the argument n as well.
+   * \return This benchmark.
+   */
+  Benchmark* Arg(long n)
+  {
+    args_m.push_back(n);
+    return this;
+  }
+
+  /**
+   * \brief Run with lo, hi and the powers of multiplier between them.
+   * \return This benchmark.
+   */
+  Benchmark* Range(long lo, long hi, long multiplier = 8)
+  {
+    args_m.push_back(lo);
+    long n = 1;
+    while (n <= lo) {
+      n *= multiplier;
+    }
+    for (; n < hi; n *= multiplier) {
+      args_m.push_back(n);
+    }
+    if (hi > lo) {
+      args_m.push_back(hi);
+    }
+    return this;
+  }
+
+  /**
+   * \brief Run exactly n iterations instead of calibrating, for workloads
+   * too long or too hungry for memory to repeat.
+   * \return This benchmark.
+   */
+  Benchmark* Iterations(long n)
+  {
+    iterations_m = n;
+    return this;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The name the benchmark was registered under.
+   */
+  const string& name() const
+  {
+    return name_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The benchmark function.
+   */
+  BenchFunction function() const
+  {
+    return function_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The arguments to run with, none if empty.
+   */
+  const vector<long>& args() const
+  {
+    return args_m;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The fixed number of iterations, 0 to calibrate.
+   */
+  long iterations() const
+  {
+    return iterations_m;
+  }
+
+private:
+  string name_m;
+  BenchFunction function_m;
+  vector<long> args_m;
+  long iterations_m;
+
+};
+
+/**
+ * \brief Accessor.
+ * \return All registered benchmarks, in order of registration.
+ */
+inline vector<Benchmark*>& registered_benchmarks()
+{
+  static vector<Benchmark*> benchmarks;
+  return benchmarks;
+}
+
+/**
+ * \brief Register a benchmark function under name.
+ * \return The new benchmark.
+ */
+inline Benchmark* register_benchmark(const string& name, BenchFunction function)
+{
+  Benchmark* benchmark = new Benchmark(name, function);
+  registered_benchmarks().push_back(benchmark);
+  return benchmark;
+}
+
+/**
+ * \brief Register the benchmark function f; setters may follow, as in
+ * BENCHMARK(f)->Arg(8).
+ */
+#define BENCHMARK(f) \
+  static Benchmark* bench_registered_##f = register_benchmark(#f, f)
+
+/**
+ * \struct BenchResult
+ * \brief The measurement of one benchmark at one argument.
+ */
+struct BenchResult {
+  string name;
+  long iterations;
+  double real_ns; // per iteration
+  double cpu_ns;  // per iteration
+  double items_per_second; // 0 if not recorded
+  string error;
+};
+
+/**
+ * \struct BenchOptions
+ * \brief The options of a benchmark run.
+ */
+struct BenchOptions {
+  BenchOptions() : format("console"), min_time(0.5), max_arg(-1) {}
+  string filter;
+  string format;
+  double min_time;
+  long max_arg; // arguments above it are skipped, unless negative
+  string out; // JSON copy of the results, unless empty
+  vector<BenchResult> results;
+};
+
+/**
+ * \brief Run one benchmark at one argument, calibrating the iterations.
+ * \return The result.
+ */
+inline BenchResult run_benchmark(const Benchmark& benchmark, long arg,
+				 const string& name, double min_time)
+{
+  BenchResult result;
+  result.name = name;
+  long iterations = benchmark.iterations() > 0 ? benchmark.iterations() : 1;
+  for (;;) {
+    BenchState state(iterations, arg);
+    try {
+      benchmark.function()(state);
+    } catch (exception& e) {
+      result.iterations = 0;
+      result.real_ns = result.cpu_ns = result.items_per_second = 0;
+      result.error = e.what();
+      return result;
+    }
+    double seconds = state.real_ns() / 1e9;
+    if (benchmark.iterations() > 0 || seconds >= min_time || iterations >= 1000000000L) {
+      result.iterations = iterations;
+      result.real_ns = (double) state.real_ns() / iterations;
+      result.cpu_ns = (double) state.cpu_ns() / iterations;
+      result.items_per_second = state.items_processed() > 0 && seconds > 0
+	? state.items_processed() / seconds : 0;
+      return result;
+    }
+    // aim a little past min_time, growing at most tenfold per attempt
+    double wanted = seconds > 0 ? iterations * 1.4 * min_time / seconds : iterations * 10.0;
+    long next = (long) min(wanted, iterations * 10.0);
+    iterations = max(next, iterations + 1);
+  }
+}
+
+/**
+ * \brief Run the registered benchmarks selected by options, collecting
+ * their results. Runs on the large-stack thread.
+ * \return NULL always.
+ */
+inline void* run_benchmarks_thread(void* p)
+{
+  BenchOptions& options = *(BenchOptions*) p;
+  vector<Benchmark*>& benchmarks = registered_benchmarks();
+  for (vector<Benchmark*>::size_type i = 0; i < benchmarks.size(); ++i) {
+    const Benchmark& benchmark = *benchmarks[i];
+    vector<long> args = benchmark.args();
+    bool no_args = args.empty();
+    if (no_args) {
+      args.push_back(0);
+    }
+    for (vector<long>::size_type j = 0; j < args.size(); ++j) {
+      ostringstream name;
+      name << benchmark.name();
+      if (!no_args) {
+	name << "/" << args[j];
+      }
+      if (name.str().find(options.filter) == string::npos
+	  || (!no_args && options.max_arg >= 0 && args[j] > options.max_arg)) {
+	continue;
+      }
+      options.results.push_back(run_benchmark(benchmark, args[j], name.str(), options.min_time));
+      if (options.format == "console") {
+	const BenchResult& r = options.results.back();
+	cout << left << setw(32) << r.name << right;
+	if (!r.error.empty()) {
+	  cout << " ERROR: " << r.error << endl;
+	  continue;
+	}
+	cout << fixed << setprecision(0)
+	     << setw(15) << r.real_ns << " ns" << setw(15) << r.cpu_ns << " ns"
+	     << setw(12) << r.iterations;
+	if (r.items_per_second > 0) {
+	  cout << setw(14) << r.items_per_second << " items/s";
+	}
+	cout << endl;
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+ * \brief Escape s for use inside a JSON string.
+ * \return The escaped string.
+ */
+inline string bench_json_escape(const string& s)
+{
+  string escaped;
+  for (string::size_type i = 0; i < s.size(); ++i) {
+    if (s[i] == '"' || s[i] == '\\') {
+      escaped += '\\';
+    }
+    escaped += s[i];
+  }
+  return escaped;
+}
+
+/**
+ * \brief Write the results as JSON, in the layout of Google Benchmark's
+ * --benchmark_format=json.
+ * \return Void.
+ */
+inline void write_bench_json(ostream& os, const BenchOptions& options, const char* executable)
+{
+  time_t now = time(NULL);
+  char date[32];
+  strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  os << "{\n  \"context\": {\n"
+     << "    \"date\": \"" << date << "\",\n"
+     << "    \"executable\": \"" << bench_json_escape(executable) << "\",\n"
+     << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+     << "    \"min_time\": " << options.min_time << "\n"
+     << "  },\n  \"benchmarks\": [";
+  os << fixed << setprecision(1);
+  for (vector<BenchResult>::size_type i = 0; i < options.results.size(); ++i) {
+    const BenchResult& r = options.results[i];
+    os << (i == 0 ? "\n" : ",\n")
+       << "    {\"name\": \"" << bench_json_escape(r.name) << "\"";
+    if (!r.error.empty()) {
+      os << ", \"error_occurred\": true, \"error_message\": \"" << bench_json_escape(r.error) << "\"}";
+      continue;
+    }
+    os << ", \"iterations\": " << r.iterations
+       << ", \"real_time\": " << r.real_ns
+       << ", \"cpu_time\": " << r.cpu_ns
+       << ", \"time_unit\": \"ns\"";
+    if (r.items_per_second > 0) {
+      os << ", \"items_per_second\": " << r.items_per_second;
+    }
+    os << "}";
+  }
+  os << "\n  ]\n}" << endl;
+}
+
+/**
+ * \brief Write the results as CSV, one line per result.
+ * \return Void.
+ */
+inline void write_bench_csv(ostream& os, const BenchOptions& options)
+{
+  os << "name,iterations,real_time,cpu_time,time_unit,items_per_second,error_message" << endl;
+  os << fixed << setprecision(1);
+  for (vector<BenchResult>::size_type i = 0; i < options.results.size(); ++i) {
+    const BenchResult& r = options.results[i];
+    os << "\"" << r.name << "\"," << r.iterations << "," << r.real_ns << "," << r.cpu_ns
+       << ",ns," << r.items_per_second << ",\"" << r.error << "\"" << endl;
+  }
+}
+
+/**
+ * \brief Run the registered benchmarks. Options:
+ *   --filter=TEXT      run only the benchmarks whose name contains TEXT
+ *   --format=FORMAT    console (default), json or csv
+ *   --min-time=SECONDS run each benchmark for at least SECONDS (0.5)
+ *   --max-arg=N        skip the arguments above N
+ *   --out=FILE         also write the results to FILE as JSON
+ * \return The exit status: 0, or 1 if any benchmark failed.
+ */
+inline int run_benchmarks(int argc, char* argv[])
+{
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    string option = argv[i];
+    if (option.compare(0, 9, "--filter=") == 0) {
+      options.filter = option.substr(9);
+    } else if (option.compare(0, 9, "--format=") == 0) {
+      options.format = option.substr(9);
+    } else if (option.compare(0, 11, "--min-time=") == 0) {
+      options.min_time = atof(option.c_str() + 11);
+    } else if (option.compare(0, 10, "--max-arg=") == 0) {
+      options.max_arg = atol(option.c_str() + 10);
+    } else if (option.compare(0, 6, "--out=") == 0) {
+      options.out = option.substr(6);
+    } else {
+      cerr << "unknown option " << option << endl;
+      return 1;
+    }
+  }
+  if (options.format != "console" && options.format != "json" && options.format != "csv") {
+    cerr << "--format expects console, json or csv" << endl;
+    return 1;
+  }
+  if (options.format == "console") {
+    cout << left << setw(32) << "Benchmark" << right
+	 << setw(18) << "Time" << setw(18) << "CPU" << setw(12) << "Iterations" << endl;
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, BENCH_STACK_SIZE);
+  pthread_t runner;
+  if (pthread_create(&runner, &attr, run_benchmarks_thread, &options) != 0) {
+    cerr << "cannot start the benchmark thread" << endl;
+    return 1;
+  }
+  pthread_join(runner, NULL);
+  pthread_attr_destroy(&attr);
+
+  if (options.format == "json") {
+    write_bench_json(cout, options, argv[0]);
+  } else if (options.format == "csv") {
+    write_bench_csv(cout, options);
+  }
+  if (!options.out.empty()) {
+    ofstream fout(options.out.c_str());
+    write_bench_json(fout, options, argv[0]);
+    if (!fout) {
+      cerr << "cannot write " << options.out << endl;
+      return 1;
+    }
+  }
+  for (vector<BenchResult>::size_type i = 0; i < options.results.size(); ++i) {
+    if (!options.results[i].error.empty()) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * \brief Define main() to run the registered benchmarks.
+ */
+#define BENCHMARK_MAIN() \
+  int main(int argc, char* argv[]) { return run_benchmarks(argc, argv); }
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,73 @@
+/**
+ * \file macro_bench.cpp
+ *
+ * Macro-benchmarks running the procedures of library.scm over lists of
+ * 10^3 to 10^6 elements. Each run starts from a fresh interpreter with the
+ * library loaded, and as cells are never freed, runs a fixed number of
+ * iterations rather than calibrating. Symbol lookup walks the dynamic
+ * scopes, so the cost of these recursive procedures grows faster than
+ * the lists; use --max-arg to leave out the largest ones.
+ */
+
+#include "benchmark.hpp"
+#include "bench_helper.hpp"
+
+/**
+ * \brief The library loaded by every macro-benchmark.
+ */
+const char* const BENCH_LIBRARY = "library.scm";
+
+/**
+ * \brief Evaluate sexpr with input bound to a list of arg random ints.
+ */
+void run_over_list(BenchState& state, const char* sexpr)
+{
+  Interpreter interp;
+  load_file(interp, BENCH_LIBRARY);
+  define_value(interp, "input", random_list(state.arg()));
+  Cell* expr = parse(interp, sexpr);
+  while (state.keep_running()) {
+    eval(interp, expr);
+  }
+  state.set_items_processed(state.iterations() * state.arg());
+}
+
+/**
+ * \brief Recursion arg calls deep, in doubles so as not to overflow.
+ */
+void BM_factorial(BenchState& state)
+{
+  Interpreter interp;
+  load_file(interp, BENCH_LIBRARY);
+  define_value(interp, "n", make_double((double) state.arg()));
+  Cell* expr = parse(interp, "(factorial n)");
+  while (state.keep_running()) {
+    eval(interp, expr);
+  }
+  state.set_items_processed(state.iterations() * state.arg());
+}
+BENCHMARK(BM_factorial)->Range(1000, 1000000, 10)->Iterations(1);
+
+void BM_list_sort(BenchState& state)
+{
+  run_over_list(state, "(list-sort < input)");
+}
+BENCHMARK(BM_list_sort)->Range(1000, 1000000, 10)->Iterations(1);
+
+void BM_reverse(BenchState& state)
+{
+  run_over_list(state, "(reverse input)");
+}
+BENCHMARK(BM_reverse)->Range(1000, 1000000, 10)->Iterations(1);
+
+void BM_map(BenchState& state)
+{
+  run_over_list(state, "(map (lambda (x) (* x 2)) input)");
+}
+BENCHMARK(BM_map)->Range(1000, 1000000, 10)->Iterations(1);
+
+void BM_reduce(BenchState& state)
+{
+  run_over_list(state, "(reduce + 0 input)");
+}
+BENCHMARK(BM_reduce)->Range(1000, 1000000, 10)->Iterations(1);
@@ -0,0 +1,218 @@
+/**
+ * \file micro_bench.cpp
+ *
+ * Micro-benchmarks of the parser, the evaluator's dispatch and symbol
+ * lookup, the persistent map behind the environments, and the arithmetic
+ * builtins, builtin and native.
+ */
+
+#include "benchmark.hpp"
+#include "bench_helper.hpp"
+#include "../RefDict.hpp"
+#include "../defbuiltin.hpp"
+
+/**
+ * \brief Parse a flat list of arg atoms, alternately ints and symbols.
+ */
+void BM_parse(BenchState& state)
+{
+  Interpreter interp;
+  string sexpr = "(";
+  for (long i = 0; i < state.arg(); ++i) {
+    sexpr += (i % 2 == 0 ? " 12345" : " symbol");
+  }
+  sexpr += ")";
+  while (state.keep_running()) {
+    parse(interp, sexpr);
+  }
+  state.set_items_processed(state.iterations() * state.arg());
+}
+BENCHMARK(BM_parse)->Range(8, 512);
+
+/**
+ * \brief Evaluate an expression already parsed, the whole time.
+ */
+void eval_repeatedly(BenchState& state, const char* sexpr)
+{
+  Interpreter interp;
+  Cell* expr = parse(interp, sexpr);
+  while (state.keep_running()) {
+    eval(interp, expr);
+  }
+}
+
+/**
+ * \brief Dispatch to the first builtin tried, with nothing to add.
+ */
+void BM_dispatch_first(BenchState& state)
+{
+  eval_repeatedly(state, "(+)");
+}
+BENCHMARK(BM_dispatch_first);
+
+/**
+ * \brief Dispatch to a builtin near the middle of the chain.
+ */
+void BM_dispatch_quote(BenchState& state)
+{
+  eval_repeatedly(state, "(quote x)");
+}
+BENCHMARK(BM_dispatch_quote);
+
+/**
+ * \brief Dispatch to a builtin near the end of the chain.
+ */
+void BM_dispatch_touch(BenchState& state)
+{
+  eval_repeatedly(state, "(touch 1)");
+}
+BENCHMARK(BM_dispatch_touch);
+
+/**
+ * \brief Look up a global symbol from under arg local frames.
+ */
+void BM_lookup_stack(BenchState& state)
+{
+  Interpreter interp;
+  eval_string(interp, "(define x 1)");
+  for (long i = 0; i < state.arg(); ++i) {
+    RefDict* frame = new RefDict(RefDict::SCOPE_LOCAL);
+    frame->insert("y", make_int((int) i));
+    interp.ref_stack().push_back(frame);
+  }
+  Cell* x = make_symbol("x");
+  while (state.keep_running()) {
+    eval(interp, x);
+  }
+  for (long i = 0; i < state.arg(); ++i) {
+    delete interp.ref_stack().back();
+    interp.ref_stack().pop_back();
+  }
+}
+BENCHMARK(BM_lookup_stack)->Arg(0)->Arg(1)->Arg(8)->Arg(64);
+
+/**
+ * \brief Names of the form used as keys of an environment.
+ */
+vector<string> bench_keys(long n)
+{
+  vector<string> keys;
+  for (long i = 0; i < n; ++i) {
+    ostringstream key;
+    key << "symbol-" << i;
+    keys.push_back(key.str());
+  }
+  return keys;
+}
+
+/**
+ * \brief Insert arg keys into an empty environment table.
+ */
+void BM_refmap_insert(BenchState& state)
+{
+  vector<string> keys = bench_keys(state.arg());
+  Cell* value = make_int(0);
+  while (state.keep_running()) {
+    RefDict::RefMap map;
+    for (vector<string>::size_type i = 0; i < keys.size(); ++i) {
+      map.insert(make_pair(keys[i], value));
+    }
+  }
+  state.set_items_processed(state.iterations() * state.arg());
+}
+BENCHMARK(BM_refmap_insert)->Range(8, 512);
+
+/**
+ * \brief Find every key of a table of arg keys.
+ */
+void BM_refmap_find(BenchState& state)
+{
+  vector<string> keys = bench_keys(state.arg());
+  RefDict::RefMap map;
+  for (vector<string>::size_type i = 0; i < keys.size(); ++i) {
+    map.insert(make_pair(keys[i], make_int((int) i)));
+  }
+  while (state.keep_running()) {
+    for (vector<string>::size_type i = 0; i < keys.size(); ++i) {
+      map.find(keys[i]);
+    }
+  }
+  state.set_items_processed(state.iterations() * state.arg());
+}
+BENCHMARK(BM_refmap_find)->Range(8, 512);
+
+/**
+ * \brief Add ints.
+ */
+void BM_add_int(BenchState& state)
+{
+  eval_repeatedly(state, "(+ 1 2 3 4)");
+}
+BENCHMARK(BM_add_int);
+
+/**
+ * \brief Add ints and doubles.
+ */
+void BM_add_double(BenchState& state)
+{
+  eval_repeatedly(state, "(+ 1.5 2 3.5 4)");
+}
+BENCHMARK(BM_add_double);
+
+/**
+ * \brief Subtract ints.
+ */
+void BM_sub_int(BenchState& state)
+{
+  eval_repeatedly(state, "(- 10 1 2 3)");
+}
+BENCHMARK(BM_sub_int);
+
+/**
+ * \brief Multiply ints.
+ */
+void BM_mul_int(BenchState& state)
+{
+  eval_repeatedly(state, "(* 1 2 3 4)");
+}
+BENCHMARK(BM_mul_int);
+
+/**
+ * \brief Divide a double by ints.
+ */
+void BM_div_double(BenchState& state)
+{
+  eval_repeatedly(state, "(/ 100.0 2 5)");
+}
+BENCHMARK(BM_div_double);
+
+/**
+ * \brief Compare ints.
+ */
+void BM_less_int(BenchState& state)
+{
+  eval_repeatedly(state, "(< 1 2)");
+}
+BENCHMARK(BM_less_int);
+
+/**
+ * \brief Add four ints in a native procedure bound by defbuiltin.
+ */
+int add4(int a, int b, int c, int d)
+{
+  return a + b + c + d;
+}
+
+/**
+ * \brief Add ints with the native add4, to compare with BM_add_int.
+ */
+void BM_native_add_int(BenchState& state)
+{
+  Interpreter interp;
+  defbuiltin<int(int, int, int, int)>(interp, "add4", add4);
+  Cell* expr = parse(interp, "(add4 1 2 3 4)");
+  while (state.keep_running()) {
+    eval(interp, expr);
+  }
+}
+BENCHMARK(BM_native_add_int);
@@ -0,0 +1,48 @@
+(define iota
+  (lambda (n)
+    (if (< n 1)
+	(quote ())
+	(cons n (iota (- n 1))))))
+
+(define data (iota 300))
+
+(list-size (reverse data))
+
+(list-sort < data)
+
+(list-sort > (map (lambda (x) (mod (* x 7919) 1000)) data))
+
+(reduce + 0 (map (lambda (x) (* x 2)) data))
+
+(factorial 12)
+
+(factorial 100.0)
+
+(define fib
+  (lambda (n)
+    (if (< n 2)
+	n
+	(+ (fib (- n 1)) (fib (- n 2))))))
+
+(fib 18)
+
+(let ((a 1.5) (b 2))
+  (/ (+ a b) (- b a)))
+
+(list (ceiling 2.5) (floor 2.5) (abs -3) (even? 4))
+
+(equal? (list 1 2 (quote x)) (list 1 2 (quote x)))
+
+(assoc 2 (quote ((1 one) (2 two) (3 three))))
+
+(list-ref data 150)
+
+(apply + (list 1 2 3))
+
+(eval (quote (* 6 7)))
+
+(pmap (lambda (x) (* x x)) data)
+
+(preduce + 0 data)
+
+(touch (future (fib 12)))
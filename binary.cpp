@@ -0,0 +1,228 @@
+/**
+ * \file binary.cpp
+ *
+ * Implementation of the binary s-expression format. A file consists of
+ *   - the 8 byte magic "MLBSX001",
+ *   - a symbol table: a count followed by length-prefixed names,
+ *   - one or more trees, each a tagged record in prefix order: ints as
+ *     zigzag varints, doubles as raw bytes, symbols as symbol table
+ *     positions and lists as an element count followed by the elements.
+ */
+
+#include "binary.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+using namespace std;
+
+const char BINARY_MAGIC[] = "MLBSX001";
+const int BINARY_MAGIC_SIZE = 8;
+
+/**
+ * \brief Record tags of a tree.
+ */
+typedef enum e_binary_tag {
+  BTAG_NIL = 0,
+  BTAG_INT,
+  BTAG_DOUBLE,
+  BTAG_SYMBOL,
+  BTAG_LIST
+} BinaryTag;
+
+/**
+ * \brief Number every symbol name occurring in c, in prefix order. The
+ * nested lists are kept on a work stack, so any depth of nesting fits.
+ * \return Void.
+ */
+void collect_symbols(Cell* const c, map<string, unsigned long>& index,
+		     vector<string>& symbols) throw (runtime_error)
+{
+  vector<Cell*> pending(1, c);
+  while (!pending.empty()) {
+    Cell* top = pending.back();
+    pending.pop_back();
+    if (symbolp(top)) {
+      string s = get_symbol(top);
+      if (!index.count(s)) {
+	index[s] = symbols.size();
+	symbols.push_back(s);
+      }
+    } else if (!nullp(top) && listp(top)) {
+      // push the elements last first, so that the first comes off first
+      vector<Cell*>::size_type base = pending.size();
+      for (Cell* temp_c = top; !nullp(temp_c); temp_c = cdr(temp_c)) {
+	pending.push_back(car(temp_c));
+      }
+      reverse(pending.begin() + base, pending.end());
+    }
+  }
+}
+
+/**
+ * \brief Encode the tree rooted at c. The trees still to be written are
+ * kept on a work stack, so any depth of nesting fits.
+ * \return Void.
+ */
+void write_tree(BinaryWriter& out, Cell* const c,
+		map<string, unsigned long>& index) throw (runtime_error)
+{
+  vector<Cell*> pending(1, c);
+  while (!pending.empty()) {
+    Cell* top = pending.back();
+    pending.pop_back();
+    if (nullp(top)) {
+      out.put_byte(BTAG_NIL);
+    } else if (intp(top)) {
+      out.put_byte(BTAG_INT);
+      out.put_svarint(get_int(top));
+    } else if (doublep(top)) {
+      out.put_byte(BTAG_DOUBLE);
+      out.put_double(get_double(top));
+    } else if (symbolp(top)) {
+      out.put_byte(BTAG_SYMBOL);
+      out.put_varint(index[get_symbol(top)]);
+    } else if (listp(top)) {
+      vector<Cell*>::size_type base = pending.size();
+      for (Cell* temp_c = top; !nullp(temp_c); temp_c = cdr(temp_c)) {
+	pending.push_back(car(temp_c));
+      }
+      out.put_byte(BTAG_LIST);
+      out.put_varint(pending.size() - base);
+      reverse(pending.begin() + base, pending.end());
+    } else {
+      throw runtime_error("only ints, doubles, symbols and lists can be written in binary");
+    }
+  }
+}
+
+string to_binary(Cell* const c) throw (runtime_error)
+{
+  map<string, unsigned long> index;
+  vector<string> symbols;
+  collect_symbols(c, index, symbols);
+  
+  BinaryWriter out;
+  for (int i = 0; i < BINARY_MAGIC_SIZE; ++i) {
+    out.put_byte(BINARY_MAGIC[i]);
+  }
+  out.put_varint(symbols.size());
+  for (vector<string>::size_type i = 0; i < symbols.size(); ++i) {
+    out.put_string(symbols[i]);
+  }
+  write_tree(out, c, index);
+  return out.buffer();
+}
+
+void write_binary_file(const char* path, Cell* const c) throw (runtime_error)
+{
+  string bytes = to_binary(c);
+  FILE* fp = fopen(path, "wb");
+  if (fp == NULL) {
+    throw runtime_error(string("cannot write ") + path);
+  }
+  size_t written = fwrite(bytes.data(), 1, bytes.size(), fp);
+  if (fclose(fp) != 0 || written != bytes.size()) {
+    throw runtime_error(string("cannot write ") + path);
+  }
+}
+
+Cell* read_binary_file(const char* path) throw (runtime_error)
+{
+  MappedFile file(path);
+  BinaryLoader loader(file.begin(), file.end());
+  Cell* c;
+  if (!loader.next(c)) {
+    throw runtime_error(string(path) + " holds no binary s-expression");
+  }
+  return c;
+}
+
+BinaryLoader::BinaryLoader(const char* begin, const char* end) throw (runtime_error)
+  : in_m(begin, end)
+{
+  if (in_m.remaining() < (unsigned long) BINARY_MAGIC_SIZE
+      || memcmp(in_m.get_bytes(BINARY_MAGIC_SIZE), BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0) {
+    throw runtime_error("not a binary s-expression file");
+  }
+  unsigned long n = in_m.get_varint();
+  if (n > in_m.remaining()) {
+    throw runtime_error("corrupt binary s-expression: symbol table larger than the file");
+  }
+  symbols_m.reserve(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    symbols_m.push_back(make_symbol(in_m.get_string().c_str()));
+  }
+}
+
+bool BinaryLoader::next(Cell*& c) throw (runtime_error)
+{
+  if (in_m.at_end()) {
+    return false;
+  }
+  c = read_tree();
+  return true;
+}
+
+Cell* BinaryLoader::read_tree() throw (runtime_error)
+{
+  // the lists begun and not finished yet, innermost last, as the number of
+  // elements each still lacks and where its elements start on elements_m;
+  // nested lists are completed before the one around them continues, so
+  // any depth of nesting fits
+  vector<pair<unsigned long, vector<Cell*>::size_type> > open;
+  elements_m.clear();
+  while (true) {
+    Cell* value;
+    unsigned long n;
+    switch (in_m.get_byte()) {
+    case BTAG_NIL:
+      value = nil;
+      break;
+    case BTAG_INT:
+      value = make_int((int) in_m.get_svarint());
+      break;
+    case BTAG_DOUBLE:
+      value = make_double(in_m.get_double());
+      break;
+    case BTAG_SYMBOL:
+      n = in_m.get_varint();
+      if (n >= symbols_m.size()) {
+	throw runtime_error("corrupt binary s-expression: dangling symbol reference");
+      }
+      value = symbols_m[n];
+      break;
+    case BTAG_LIST:
+      n = in_m.get_varint();
+      if (n > in_m.remaining()) {
+	throw runtime_error("corrupt binary s-expression: list longer than the file");
+      }
+      if (n > 0) {
+	open.push_back(make_pair(n, elements_m.size()));
+	continue;
+      }
+      value = nil;
+      break;
+    default:
+      throw runtime_error("corrupt binary s-expression: unknown tag");
+    }
+
+    // add the value to the innermost open list, and finish every list it
+    // completes
+    while (!open.empty()) {
+      elements_m.push_back(value);
+      if (--open.back().first > 0) {
+	break;
+      }
+      value = nil;
+      for (vector<Cell*>::size_type i = elements_m.size(); i-- > open.back().second; ) {
+	value = cons(elements_m[i], value);
+      }
+      elements_m.resize(open.back().second);
+      open.pop_back();
+    }
+    if (open.empty()) {
+      return value;
+    }
+  }
+}
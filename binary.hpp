@@ -0,0 +1,70 @@
+/**
+ * \file binary.hpp
+ *
+ * Encapsulates the interface for the binary s-expression format, a compact
+ * alternative to the text syntax for loading large data sets.
+ */
+
+#ifndef BINARY_HPP
+#define BINARY_HPP
+
+#include "cons.hpp"
+#include "BinaryIO.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \class BinaryLoader
+ * \brief Class BinaryLoader. Decodes the trees stored in a binary
+ * s-expression buffer one at a time, without tokenizing any text.
+ */
+class BinaryLoader {
+  
+public:
+
+  /**
+   * \brief Constructor reading the header of the bytes in [begin, end)
+   * (error if they do not start with a valid header).
+   */
+  BinaryLoader(const char* begin, const char* end) throw (runtime_error);
+
+  /**
+   * \brief Decode the next tree.
+   * \return False when all trees have been read, otherwise true with the
+   * tree in c.
+   */
+  bool next(Cell*& c) throw (runtime_error);
+
+private:
+  Cell* read_tree() throw (runtime_error);
+  
+  BinaryReader in_m;
+  vector<Cell*> symbols_m; // one shared cell per symbol table entry
+  vector<Cell*> elements_m; // scratch stack for list elements
+  
+};
+
+/**
+ * \brief Encode c, preceded by the header of its symbols, in the binary
+ * s-expression format (error if c holds a procedure).
+ * \return The encoded bytes.
+ */
+string to_binary(Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Write c to the file at path in the binary s-expression format
+ * (error if the file cannot be written).
+ */
+void write_binary_file(const char* path, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Read the first tree stored in the file at path (error if the file
+ * holds no valid binary s-expression).
+ * \return The tree.
+ */
+Cell* read_binary_file(const char* path) throw (runtime_error);
+
+#endif // BINARY_HPP
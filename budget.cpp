@@ -0,0 +1,9 @@
+/**
+ * \file budget.cpp
+ *
+ * Implementation of the resource budget of top-level expressions.
+ */
+
+#include "budget.hpp"
+
+thread_local Budget* eval_budget = NULL;
@@ -0,0 +1,218 @@
+/**
+ * \file budget.hpp
+ *
+ * Encapsulates the resource budget of one top-level expression: the
+ * procedure calls and loop iterations it may take, the bytes of cells it
+ * may make and the time it may run. Running out of any of them fails the
+ * expression with an error of its own type. The budget of the expression
+ * being evaluated is installed on every thread working on it, where the
+ * factories in cons.hpp and the evaluator charge it.
+ */
+
+#ifndef BUDGET_HPP
+#define BUDGET_HPP
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * \struct Limits
+ * \brief The budget given to every top-level expression; 0 for no limit.
+ */
+struct Limits {
+  long max_steps;     // procedure calls and loop iterations
+  long max_bytes;     // bytes of cells made
+  long max_millis;    // milliseconds of wall-clock time
+
+  /**
+   * \brief Constructor of Limits without any limit.
+   */
+  Limits()
+    : max_steps(0), max_bytes(0), max_millis(0)
+  {
+
+  }
+
+  /**
+   * \brief Check whether any limit is set.
+   * \return True if an expression needs a budget.
+   */
+  bool any() const
+  {
+    return max_steps > 0 || max_bytes > 0 || max_millis > 0;
+  }
+};
+
+/**
+ * \class StepLimitError
+ * \brief Thrown when an expression takes more steps than its budget.
+ */
+class StepLimitError : public runtime_error {
+public:
+  StepLimitError() : runtime_error("step limit exceeded") { }
+};
+
+/**
+ * \class MemoryLimitError
+ * \brief Thrown when an expression makes more bytes of cells than its
+ * budget.
+ */
+class MemoryLimitError : public runtime_error {
+public:
+  MemoryLimitError() : runtime_error("memory limit exceeded") { }
+};
+
+/**
+ * \class DeadlineError
+ * \brief Thrown when an expression runs past its deadline.
+ */
+class DeadlineError : public runtime_error {
+public:
+  DeadlineError() : runtime_error("time limit exceeded") { }
+};
+
+/**
+ * \class Budget
+ * \brief Class Budget. What is left of the limits of one expression,
+ * shared by the threads working on it, and by any future it leaves
+ * running.
+ */
+class Budget : public enable_shared_from_this<Budget> {
+
+public:
+
+  /**
+   * \brief Steps taken between two looks at the clock, less one.
+   */
+  static const long CLOCK_MASK = 1023;
+
+  /**
+   * \brief Constructor of the Budget of limits, starting now.
+   */
+  explicit Budget(const Limits& limits)
+    : steps_left_m(limits.max_steps > 0 ? limits.max_steps : LONG_MAX),
+      bytes_left_m(limits.max_bytes > 0 ? limits.max_bytes : LONG_MAX),
+      timed_m(limits.max_millis > 0),
+      deadline_m(chrono::steady_clock::now() + chrono::milliseconds(limits.max_millis))
+  {
+
+  }
+
+  /**
+   * \brief Take one step, and every CLOCK_MASK + 1 steps see whether the
+   * deadline has passed.
+   * \return Void.
+   */
+  void step() throw (runtime_error)
+  {
+    long left = steps_left_m.fetch_sub(1, memory_order_relaxed) - 1;
+    if (left < 0) {
+      throw StepLimitError();
+    }
+    if ((left & CLOCK_MASK) == 0 && timed_m && chrono::steady_clock::now() > deadline_m) {
+      throw DeadlineError();
+    }
+  }
+
+  /**
+   * \brief Spend bytes on a new cell.
+   * \return Void.
+   */
+  void allocate(size_t bytes) throw (runtime_error)
+  {
+    if (bytes_left_m.fetch_sub(bytes, memory_order_relaxed) < (long) bytes) {
+      throw MemoryLimitError();
+    }
+  }
+
+private:
+  Budget(const Budget&);
+  Budget& operator= (const Budget&);
+
+  atomic<long> steps_left_m;
+  atomic<long> bytes_left_m;
+  bool timed_m;
+  chrono::steady_clock::time_point deadline_m;
+
+};
+
+/**
+ * \brief The budget of the expression the calling thread works on, NULL
+ * if it is unlimited.
+ */
+extern thread_local Budget* eval_budget;
+
+/**
+ * \class BudgetScope
+ * \brief Class BudgetScope. Installs a budget on the calling thread for as
+ * long as the scope lives, and then the one before it.
+ */
+class BudgetScope {
+
+public:
+
+  /**
+   * \brief Constructor of the BudgetScope, installing budget.
+   */
+  explicit BudgetScope(Budget* budget)
+    : previous_m(eval_budget)
+  {
+    eval_budget = budget;
+  }
+
+  /**
+   * \brief Destructor of the BudgetScope.
+   */
+  ~BudgetScope()
+  {
+    eval_budget = previous_m;
+  }
+
+private:
+  BudgetScope(const BudgetScope&);
+  BudgetScope& operator= (const BudgetScope&);
+
+  Budget* previous_m;
+
+};
+
+/**
+ * \brief Charge a step to the budget of the calling thread, if any.
+ * \return Void.
+ */
+inline void charge_step() throw (runtime_error)
+{
+  if (eval_budget != NULL) {
+    eval_budget->step();
+  }
+}
+
+/**
+ * \brief Charge a cell of bytes to the budget of the calling thread, if
+ * any.
+ * \return Void.
+ */
+inline void charge_bytes(size_t bytes) throw (runtime_error)
+{
+  if (eval_budget != NULL) {
+    eval_budget->allocate(bytes);
+  }
+}
+
+/**
+ * \brief Get a share of the budget of the calling thread, to install on
+ * another thread taking over part of the work.
+ * \return The budget, empty if there is none.
+ */
+inline shared_ptr<Budget> share_budget()
+{
+  return eval_budget != NULL ? eval_budget->shared_from_this() : shared_ptr<Budget>();
+}
+
+#endif // BUDGET_HPP
@@ -10,12 +10,19 @@
 #define CONS_HPP
 
 #include <iostream>
+#include <cstring>
 #include "Cell.hpp"
 #include "IntCell.hpp"
 #include "DoubleCell.hpp"
 #include "SymbolCell.hpp"
+#include "SymbolTable.hpp"
 #include "ConsCell.hpp"
 #include "ProcedureCell.hpp"
+#include "MemoProcedureCell.hpp"
+#include "FutureCell.hpp"
+#include "NativeProcedureCell.hpp"
+#include "heap.hpp"
+#include "budget.hpp"
 
 using namespace std;
 
@@ -30,6 +37,8 @@ extern Cell* const nil;
  */
 inline Cell* make_int(const int i)
 {
+  charge_bytes(sizeof(IntCell));
+  count_made(HEAP_INT, sizeof(IntCell));
   return new IntCell(i);
 }
 
@@ -39,16 +48,19 @@ inline Cell* make_int(const int i)
  */
 inline Cell* make_double(const double d)
 {
+  charge_bytes(sizeof(DoubleCell));
+  count_made(HEAP_DOUBLE, sizeof(DoubleCell));
   return new DoubleCell(d);
 }
 
 /**
- * \brief Make a symbol cell.
- * \param s The initial symbol name to be stored in the new cell.
+ * \brief Make a symbol cell, or rather look up the one cell shared by all
+ * symbols of that name.
+ * \param s The symbol name to be stored in the cell.
  */
 inline Cell* make_symbol(const char* const s)
 {
-  return new SymbolCell(s);
+  return SymbolTable::instance().intern(s);
 }
 
 /**
@@ -63,9 +75,25 @@ inline Cell* cons(Cell* const my_car, Cell* const my_cdr)
   if (my_cdr != nil && !(my_cdr->is_cons())) {
     throw std::runtime_error("cdr can only store ConsCell or null");
   }
+  charge_bytes(sizeof(ConsCell));
+  count_made(HEAP_CONS, sizeof(ConsCell));
   return new ConsCell(my_car, my_cdr);
 }
 
+/**
+ * \brief Replace the cdr of a conspair cell just made by cons(), which
+ * nothing else has seen yet, to build a list front to back.
+ * \param c The conspair cell.
+ * \param my_cdr The new cdr pointer.
+ */
+inline void set_cdr(Cell* const c, Cell* const my_cdr)
+{
+  if (my_cdr != nil && !(my_cdr->is_cons())) {
+    throw std::runtime_error("cdr can only store ConsCell or null");
+  }
+  static_cast<ConsCell*>(c)->set_cdr(my_cdr);
+}
+
 /**
  * \brief Make a procedure cell.
  * \param my_formals A list of the procedure's formal parameter names.
@@ -73,9 +101,51 @@ inline Cell* cons(Cell* const my_car, Cell* const my_cdr)
  */
 inline Cell* lambda(Cell* const my_formals, Cell* const my_body)
 {
+  charge_bytes(sizeof(ProcedureCell));
+  count_made(HEAP_PROCEDURE, sizeof(ProcedureCell));
   return new ProcedureCell(my_formals, my_body);
 }
 
+/**
+ * \brief Make a memoized procedure cell.
+ * \param my_formals A list of the procedure's formal parameter names.
+ * \param my_body The body (an expression) of the procedure.
+ * \param capacity The maximum number of results kept in the cache.
+ */
+inline Cell* memoize(Cell* const my_formals, Cell* const my_body, const int capacity)
+{
+  charge_bytes(sizeof(MemoProcedureCell));
+  count_made(HEAP_PROCEDURE, sizeof(MemoProcedureCell));
+  return new MemoProcedureCell(my_formals, my_body, capacity);
+}
+
+/**
+ * \brief Make a future cell.
+ * \param thunk The computation of the value of the future.
+ */
+inline FutureCell* make_future(const FutureCell::Thunk& thunk)
+{
+  charge_bytes(sizeof(FutureCell));
+  count_made(HEAP_FUTURE, sizeof(FutureCell));
+  return new FutureCell(thunk);
+}
+
+/**
+ * \brief Make a native procedure cell.
+ * \param name The symbol the procedure is defined as.
+ * \param function The C++ function implementing the procedure.
+ * \param min_args The least number of arguments taken.
+ * \param max_args The most arguments taken, or NativeProcedureCell::VARIADIC.
+ * \param data Passed to every call of the function.
+ */
+inline Cell* make_native(Cell* const name, NativeProcedureCell::Function function,
+			 const int min_args, const int max_args, void* data)
+{
+  charge_bytes(sizeof(NativeProcedureCell));
+  count_made(HEAP_PROCEDURE, sizeof(NativeProcedureCell));
+  return new NativeProcedureCell(name, function, min_args, max_args, data);
+}
+
 /**
  * \brief Check if c points to an empty list, i.e., is a null pointer.
  * \return True iff c points to an empty list, i.e., is a null pointer.
@@ -103,6 +173,33 @@ inline bool procedurep(Cell* const c)
   return !nullp(c) && c->is_procedure();
 }
 
+/**
+ * \brief Check if c is a memoized procedure cell.
+ * \return True iff c is a memoized procedure cell.
+ */
+inline bool memoizedp(Cell* const c)
+{
+  return !nullp(c) && c->is_memoized();
+}
+
+/**
+ * \brief Check if c is a future cell.
+ * \return True iff c is a future cell.
+ */
+inline bool futurep(Cell* const c)
+{
+  return !nullp(c) && c->is_future();
+}
+
+/**
+ * \brief Check if c is a native procedure cell.
+ * \return True iff c is a native procedure cell.
+ */
+inline bool nativep(Cell* const c)
+{
+  return !nullp(c) && c->is_native();
+}
+
 /**
  * \brief Check if c points to an int cell.
  * \return True iff c points to an int cell.
@@ -196,6 +293,139 @@ inline Cell* get_body(Cell* const c)
   return c->get_body();
 }
 
+/**
+ * \brief Accessor (error if c is not a procedure cell).
+ * \return Pointer to the symbol the procedure pointed to by c was first
+ * defined as, nil if it was never defined.
+ */
+inline Cell* get_name(Cell* const c)
+{
+  return c->get_name();
+}
+
+/**
+ * \brief Accessor (error if c is not a memoized procedure cell).
+ * \return Pointer to the result cache of the procedure pointed to by c.
+ */
+inline MemoCache* get_memo(Cell* const c)
+{
+  return c->get_memo();
+}
+
+/**
+ * \brief Accessor (error if c is not a future cell).
+ * \return The value of the future pointed to by c, once computed.
+ */
+inline Cell* touch(Cell* const c)
+{
+  return c->touch();
+}
+
+/**
+ * \brief Accessor (error if c is not a native procedure cell).
+ * \return The native procedure c points to.
+ */
+inline NativeProcedureCell* get_native(Cell* const c)
+{
+  if (!nativep(c)) {
+    throw runtime_error("not a native procedure");
+  }
+  return static_cast<NativeProcedureCell*>(c);
+}
+
+/**
+ * \brief Delete a cell made by one of the factories above. Symbols are
+ * shared by all their uses and never deleted.
+ * \return Void.
+ */
+inline void free_cell(Cell* const c)
+{
+  if (nullp(c) || symbolp(c)) {
+    return;
+  }
+  if (intp(c)) {
+    count_deleted(HEAP_INT, sizeof(IntCell));
+  } else if (doublep(c)) {
+    count_deleted(HEAP_DOUBLE, sizeof(DoubleCell));
+  } else if (listp(c)) {
+    count_deleted(HEAP_CONS, sizeof(ConsCell));
+  } else if (memoizedp(c)) {
+    count_deleted(HEAP_PROCEDURE, sizeof(MemoProcedureCell));
+  } else if (procedurep(c)) {
+    count_deleted(HEAP_PROCEDURE, sizeof(ProcedureCell));
+  } else if (nativep(c)) {
+    count_deleted(HEAP_PROCEDURE, sizeof(NativeProcedureCell));
+  } else if (futurep(c)) {
+    count_deleted(HEAP_FUTURE, sizeof(FutureCell));
+  }
+  delete c;
+}
+
+/**
+ * \brief Structural hash of the subtree rooted at c. Procedures hash by
+ * identity, doubles by bit pattern, everything else by value.
+ * \return The hash value.
+ */
+inline unsigned long cell_hash(Cell* const c)
+{
+  if (nullp(c)) {
+    return 0x9e3779b9UL;
+  } else if (intp(c)) {
+    return (unsigned long) get_int(c) * 2654435761UL;
+  } else if (doublep(c)) {
+    double d = get_double(c);
+    unsigned long long bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return (unsigned long) (bits ^ (bits >> 29)) * 2654435761UL;
+  } else if (symbolp(c)) {
+    return c->get_symbol_hash();
+  } else if (listp(c)) {
+    unsigned long hash = 17;
+    for (Cell* temp_c = c; !nullp(temp_c); temp_c = cdr(temp_c)) {
+      hash = hash * 31 + cell_hash(car(temp_c));
+    }
+    return hash;
+  }
+  return (unsigned long) c;
+}
+
+/**
+ * \brief Structural equality of the subtrees rooted at a and b. Identical
+ * pointers compare equal without being walked. Doubles compare by bit
+ * pattern, so that -0.0 is not taken for 0.0, which it prints and divides
+ * differently from.
+ * \return True iff a and b hold the same value.
+ */
+inline bool cell_equal(Cell* const a, Cell* const b)
+{
+  if (a == b) {
+    return true;
+  } else if (nullp(a) || nullp(b)) {
+    return false;
+  } else if (intp(a) && intp(b)) {
+    return get_int(a) == get_int(b);
+  } else if (doublep(a) && doublep(b)) {
+    double d_a = get_double(a);
+    double d_b = get_double(b);
+    return memcmp(&d_a, &d_b, sizeof(double)) == 0;
+  } else if (symbolp(a) && symbolp(b)) {
+    // interned symbols of the same name are the same cell
+    return a->get_symbol_hash() == b->get_symbol_hash() && get_symbol(a) == get_symbol(b);
+  } else if (listp(a) && listp(b)) {
+    Cell* temp_a = a;
+    Cell* temp_b = b;
+    while (!nullp(temp_a) && !nullp(temp_b)) {
+      if (!cell_equal(car(temp_a), car(temp_b))) {
+	return false;
+      }
+      temp_a = cdr(temp_a);
+      temp_b = cdr(temp_b);
+    }
+    return temp_a == temp_b;
+  }
+  return false;
+}
+
 /**
  * \brief Print the subtree rooted at c, in s-expression notation.
  * \param os The output stream to print to.
@@ -0,0 +1,202 @@
+/**
+ * \file defbuiltin.hpp
+ *
+ * Encapsulates the binding of plain C++ functions as native procedures,
+ * with the arity check and the conversion of every argument and of the
+ * result generated from the signature at compile time:
+ *
+ *   int gcd(int a, int b) { return b == 0 ? a : gcd(b, a % b); }
+ *
+ *   defbuiltin<int(int, int)>(interp, "gcd", gcd);
+ *
+ * The types converted are int, double, bool (an int, 0 for false, taking
+ * any number like if), string (a symbol), Cell* (any value, unconverted),
+ * and vector of any of them (a list). A void function gives nil.
+ */
+
+#ifndef DEFBUILTIN_HPP
+#define DEFBUILTIN_HPP
+
+#include "microlisp.hpp"
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \struct CellValue
+ * \brief Conversion between the C++ type T and the cells holding its
+ * values: unbox (error if the cell does not hold a T) and box.
+ */
+template <typename T>
+struct CellValue;
+
+template <>
+struct CellValue<int> {
+  static int unbox(Cell* const c) throw (runtime_error)
+  {
+    if (!intp(c)) {
+      throw runtime_error("native procedure expects an int argument");
+    }
+    return get_int(c);
+  }
+  static Cell* box(int value)
+  {
+    return make_int(value);
+  }
+};
+
+template <>
+struct CellValue<double> {
+  static double unbox(Cell* const c) throw (runtime_error)
+  {
+    if (!intp(c) && !doublep(c)) {
+      throw runtime_error("native procedure expects a numeric argument");
+    }
+    return get_double(c);
+  }
+  static Cell* box(double value)
+  {
+    return make_double(value);
+  }
+};
+
+template <>
+struct CellValue<bool> {
+  static bool unbox(Cell* const c) throw (runtime_error)
+  {
+    return CellValue<double>::unbox(c) != 0;
+  }
+  static Cell* box(bool value)
+  {
+    return make_int(value ? 1 : 0);
+  }
+};
+
+template <>
+struct CellValue<string> {
+  static string unbox(Cell* const c) throw (runtime_error)
+  {
+    if (!symbolp(c)) {
+      throw runtime_error("native procedure expects a symbol argument");
+    }
+    return get_symbol(c);
+  }
+  static Cell* box(const string& value)
+  {
+    return make_symbol(value.c_str());
+  }
+};
+
+template <>
+struct CellValue<Cell*> {
+  static Cell* unbox(Cell* const c)
+  {
+    return c;
+  }
+  static Cell* box(Cell* const value)
+  {
+    return value;
+  }
+};
+
+template <typename T>
+struct CellValue<vector<T> > {
+  static vector<T> unbox(Cell* const c) throw (runtime_error)
+  {
+    if (!listp(c)) {
+      throw runtime_error("native procedure expects a list argument");
+    }
+    vector<T> values;
+    for (Cell* temp_c = c; !nullp(temp_c); temp_c = cdr(temp_c)) {
+      values.push_back(CellValue<T>::unbox(car(temp_c)));
+    }
+    return values;
+  }
+  static Cell* box(const vector<T>& values)
+  {
+    Cell* list = nil;
+    for (typename vector<T>::size_type i = values.size(); i-- > 0; ) {
+      list = cons(CellValue<T>::box(values[i]), list);
+    }
+    return list;
+  }
+};
+
+/**
+ * \struct ArgIndices
+ * \brief The indices 0 to n-1 of the arguments of a function taking n,
+ * built by MakeArgIndices<n>::type.
+ */
+template <int... I>
+struct ArgIndices {};
+
+template <int N, int... I>
+struct MakeArgIndices: MakeArgIndices<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeArgIndices<0, I...> {
+  typedef ArgIndices<I...> type;
+};
+
+/**
+ * \struct BuiltinBinding
+ * \brief The native procedure calling a function of type Signature,
+ * which it receives as data.
+ */
+template <typename Signature>
+struct BuiltinBinding;
+
+template <typename R, typename... Args>
+struct BuiltinBinding<R(Args...)> {
+  typedef R (*Function)(Args...);
+  static const int ARITY = sizeof...(Args);
+
+  template <int... I>
+  static Cell* invoke(Function function, Cell* const argv[], ArgIndices<I...>)
+  {
+    return CellValue<typename decay<R>::type>::box(
+      function(CellValue<typename decay<Args>::type>::unbox(argv[I])...));
+  }
+
+  static Cell* call(Interpreter&, Cell* const argv[], int, void* data)
+  {
+    return invoke(*static_cast<Function*>(data), argv, typename MakeArgIndices<ARITY>::type());
+  }
+};
+
+template <typename... Args>
+struct BuiltinBinding<void(Args...)> {
+  typedef void (*Function)(Args...);
+  static const int ARITY = sizeof...(Args);
+
+  template <int... I>
+  static Cell* invoke(Function function, Cell* const argv[], ArgIndices<I...>)
+  {
+    function(CellValue<typename decay<Args>::type>::unbox(argv[I])...);
+    return nil;
+  }
+
+  static Cell* call(Interpreter&, Cell* const argv[], int, void* data)
+  {
+    return invoke(*static_cast<Function*>(data), argv, typename MakeArgIndices<ARITY>::type());
+  }
+};
+
+/**
+ * \brief Define name in the global environment of interp as the native
+ * procedure calling function, which takes exactly as many arguments as
+ * Signature has parameters. The binding lives as long as the program.
+ * \return The native procedure cell.
+ */
+template <typename Signature>
+Cell* defbuiltin(Interpreter& interp, const char* name, Signature* function)
+{
+  typedef BuiltinBinding<Signature> Binding;
+  return define_native(interp, name, Binding::call, Binding::ARITY, Binding::ARITY,
+		       new typename Binding::Function(function));
+}
+
+#endif // DEFBUILTIN_HPP
@@ -8,19 +8,44 @@
  * - Fix a bug that prevent (quote ()) from calling
  * - Support more Scheme functionalities e.g. define, not, print, eval, <
  * - Use STL map to store the symbol definition
+ * - Evaluate call arguments onto a shared argument stack instead of
+ *   building intermediate lists
+ * - Evaluate let directly in a new frame instead of through a lambda
+ * - Support memoize and memo-stats for caching results of pure procedures
+ * - Support write-binary and read-binary for the binary s-expression format
+ * - Keep all evaluator state in an explicitly passed Interpreter
+ * - Support pmap for mapping a pure procedure over a list in parallel
+ * - Support future, touch and preduce for divide-and-conquer parallelism
+ * - Track the procedures being applied for the sampling profiler
+ * - Count and time the calls of procedures and builtins for profile-report
+ * - Support heap-stats for the cells made and live per type
+ * - Free the local frame of a procedure call or let once it returns
+ * - Apply native procedures defined by a program embedding the interpreter
+ * - Print into the interpreter's output buffer, and support flush
+ * - Run self tail calls, and self calls under cons, without recursing
+ * - Fail an eval() nested deeper than the limit or than the stack holds
+ * - Give every top-level expression a budget of steps, bytes and time
  * 
  */
 
 #include "eval.hpp"
 #include "eval_helper.hpp"
 #include "RefDict.hpp"
+#include "MemoCache.hpp"
+#include "binary.hpp"
+#include "ThreadPool.hpp"
+#include "profile.hpp"
+#include "heap.hpp"
+#include "budget.hpp"
 #include <utility>
 #include <iterator>
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <pthread.h>
 
 using namespace std;
 
@@ -28,23 +53,104 @@ using namespace std;
 // Remark: use typedef to increase convenience when modifying the template arguments
 
 
-typedef vector<RefDict*> RefStack;
+typedef Interpreter::RefStack RefStack;
+typedef Interpreter::ArgStack ArgStack;
+
+/**
+ * \brief Number of arguments of a native procedure passed without
+ * allocating.
+ */
+const int NATIVE_INLINE_ARGS = 8;
+
+/**
+ * \brief Stack left unused below the deepest eval(), for the calls it
+ * makes before the next eval() and for unwinding an error.
+ */
+const size_t STACK_RESERVE = 256 * 1024;
+
+/**
+ * \brief The lowest address of the stack of the calling thread eval() may
+ * reach, STACK_RESERVE above the end of the stack.
+ * \return The address, NULL if the stack is unknown.
+ */
+const char* stack_floor()
+{
+  static thread_local bool known = false;
+  static thread_local const char* floor = NULL;
+  if (!known) {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+      void* addr;
+      size_t size;
+      if (pthread_attr_getstack(&attr, &addr, &size) == 0 && size > STACK_RESERVE) {
+	floor = (const char*) addr + STACK_RESERVE;
+      }
+      pthread_attr_destroy(&attr);
+    }
+    known = true;
+  }
+  return floor;
+}
+
+/**
+ * \class DepthGuard
+ * \brief Class DepthGuard. Counts an eval() in the depth of its
+ * interpreter for as long as the guard lives, failing the eval() if it
+ * would nest deeper than the interpreter allows, or than the stack of the
+ * thread holds, rather than overflow the stack.
+ */
+class DepthGuard {
+
+public:
+
+  /**
+   * \brief Constructor of the DepthGuard.
+   */
+  explicit DepthGuard(Interpreter& interp) throw (runtime_error)
+    : depth_m(interp.depth())
+  {
+    if (depth_m >= interp.max_depth()) {
+      throw runtime_error("maximum recursion depth exceeded");
+    }
+    const char* floor = stack_floor();
+    char here;
+    if (floor != NULL && (const char*) &here < floor) {
+      throw runtime_error("stack exhausted by recursion");
+    }
+    ++depth_m;
+  }
+
+  /**
+   * \brief Destructor of the DepthGuard.
+   */
+  ~DepthGuard()
+  {
+    --depth_m;
+  }
+
+private:
+  DepthGuard(const DepthGuard&);
+  DepthGuard& operator= (const DepthGuard&);
+
+  int& depth_m;
+
+};
 
 //////////////////////////// Function Declaration ////////////////////////////
 
 /**
- * \brief Initialize a stack of RefDict.
+ * \brief Pop and delete the local frames above depth.
  *
- * \return The resulting stack.
+ * \return Void.
  */
-RefStack init_stack() throw (runtime_error);
+void pop_frames(RefStack& ref_stack, RefStack::size_type depth);
 
 /**
  * \brief Look up a specific symbol in the whole stack from top to bottom.
  *
  * \return A pointer to the corresponding cell if found, otherwise, exception.
  */
-Cell* lookup_stack(string s) throw (runtime_error);
+Cell* lookup_stack(Interpreter& interp, string s) throw (runtime_error);
 
 /**
  * \brief Overloaded version of the lookup_stack(string s). Automatically convert
@@ -52,21 +158,37 @@ Cell* lookup_stack(string s) throw (runtime_error);
  *
  * \return A pointer to the corresponding cell if found, otherwise, exception.
  */
-Cell* lookup_stack(Cell* const c) throw (runtime_error);
+Cell* lookup_stack(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Invoke the operator op (a builtin symbol or a ProcedureCell) on the
+ * unevaluated operand list c.
+ *
+ * \return Result from evaluating the operation.
+ */
+Cell* dispatch(Interpreter& interp, Cell* const op, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Invoke the builtin named by the symbol op on the unevaluated
+ * operand list c.
+ *
+ * \return Result from evaluating the operation.
+ */
+Cell* dispatch_builtin(Interpreter& interp, Cell* const op, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Get the final value of a given Cell c. The final value can be null.
  *
  * \return A pointer to Cell storing the value evaluated from c.
  */
-Cell* get_fval(Cell* const c) throw (runtime_error);
+Cell* get_fval(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Get the non-null final value of a given Cell c. The final value
  * cannot be null (error if the result is null).
  * \return A pointer to Cell storing the value evaluated from c.
  */
-Cell* get_nnfval(Cell* const c) throw (runtime_error);
+Cell* get_nnfval(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Create a IntCell or DoubleCell depending on the value of
@@ -85,7 +207,7 @@ Cell* make_num(bool& is_int, double n) throw (runtime_error);
  * \return A pointer to cell that contains either int or double value.
  * (int if all numbers to be summed is int, otherwise, double).
  */
-Cell* operand_sum(Cell* const c) throw (runtime_error);
+Cell* operand_sum(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the difference of operands starting from c.
@@ -95,7 +217,7 @@ Cell* operand_sum(Cell* const c) throw (runtime_error);
  * \return A pointer to cell resulting from the operation.
  * (IntCell if all numbers to be substracted is int, otherwise, DoubleCell).
  */
-Cell* operand_diff(Cell* const c) throw (runtime_error);
+Cell* operand_diff(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the product of operands starting from c.
@@ -104,7 +226,7 @@ Cell* operand_diff(Cell* const c) throw (runtime_error);
  * \return A pointer to cell resulting from the operation
  * (IntCell if all numbers to be substracted is int, otherwise, DoubleCell).
  */
-Cell* operand_product(Cell* const c) throw (runtime_error);
+Cell* operand_product(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the quotient of operands starting from c.
@@ -113,7 +235,7 @@ Cell* operand_product(Cell* const c) throw (runtime_error);
  * \return A pointer to Cell resulting from the operation
  * (IntCell if all numbers to be substracted is int, otherwise, DoubleCell).
  */
-Cell* operand_quotient(Cell* const c) throw (runtime_error);
+Cell* operand_quotient(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the ceil value of a DoubleCell c.
@@ -122,7 +244,7 @@ Cell* operand_quotient(Cell* const c) throw (runtime_error);
  *
  * \return A pointer to IntCell resulting from the operation.
  */
-Cell* operand_ceiling(Cell* const c) throw (runtime_error);
+Cell* operand_ceiling(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the floor value of a DoubleCell c.
@@ -131,7 +253,7 @@ Cell* operand_ceiling(Cell* const c) throw (runtime_error);
  *
  * \return A pointer to IntCell resulting from the operation.
  */
-Cell* operand_floor(Cell* const c) throw (runtime_error);
+Cell* operand_floor(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether a given Cell c is null.
@@ -141,7 +263,7 @@ Cell* operand_floor(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if c is null, otherwise,
  * a pointer to IntCell storing 0.
  */
-Cell* operand_nullp(Cell* const c) throw (runtime_error);
+Cell* operand_nullp(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether a given Cell c is null.
@@ -151,7 +273,7 @@ Cell* operand_nullp(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if c is symbol, otherwise,
  * a pointer to IntCell storing 0.
  */
-Cell* operand_symbolp(Cell* const c) throw (runtime_error);
+Cell* operand_symbolp(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether a given Cell c is null.
@@ -161,7 +283,7 @@ Cell* operand_symbolp(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if c is int, otherwise,
  * a pointer to IntCell storing 0.
  */
-Cell* operand_intp(Cell* const c) throw (runtime_error);
+Cell* operand_intp(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether a given Cell c is null.
@@ -171,7 +293,7 @@ Cell* operand_intp(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if c is double, otherwise,
  * a pointer to IntCell storing 0.
  */
-Cell* operand_doublep(Cell* const c) throw (runtime_error);
+Cell* operand_doublep(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether a given Cell c is null.
@@ -181,7 +303,7 @@ Cell* operand_doublep(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if c is list, otherwise,
  * a pointer to IntCell storing 0.
  */
-Cell* operand_listp(Cell* const c) throw (runtime_error);
+Cell* operand_listp(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether a given Cell c is null.
@@ -191,7 +313,7 @@ Cell* operand_listp(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if c is procedure, otherwise,
  * a pointer to IntCell storing 0.
  */
-Cell* operand_procedurep(Cell* const c) throw (runtime_error);
+Cell* operand_procedurep(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the result of if function using c as the first argument.
@@ -201,7 +323,7 @@ Cell* operand_procedurep(Cell* const c) throw (runtime_error);
  * \return A pointer to Cell storing the value evaluating from the 2nd or
  * the 3rd argument (the 2nd if c stores non-zero, the 3rd if c stores 0).
  */
-Cell* operand_if(Cell* const c) throw (runtime_error);
+Cell* operand_if(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the result of if function using c as the first argument.
@@ -211,7 +333,7 @@ Cell* operand_if(Cell* const c) throw (runtime_error);
  * \return A pointer to Cell storing the value evaluating from the 2nd or
  * the 3rd argument (the 2nd if c stores non-zero, the 3rd if c stores 0).
  */
-Cell* operand_cons(Cell* const c) throw (runtime_error);
+Cell* operand_cons(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the car cell of a given ConsCell c.
@@ -220,7 +342,7 @@ Cell* operand_cons(Cell* const c) throw (runtime_error);
  *
  * \return A pointer to Cell which is the car cell of c.
  */
-Cell* operand_car(Cell* const c) throw (runtime_error);
+Cell* operand_car(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Give the cdr cell of a given ConsCell c.
@@ -229,7 +351,7 @@ Cell* operand_car(Cell* const c) throw (runtime_error);
  *
  * \return A pointer to Cell which is the cdr cell of c.
  */
-Cell* operand_cdr(Cell* const c) throw (runtime_error);
+Cell* operand_cdr(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Prevent a cell being evaluated once (Directly output the
@@ -238,7 +360,7 @@ Cell* operand_cdr(Cell* const c) throw (runtime_error);
  *
  * \return null always.
  */
-Cell* operand_quote(Cell* const c) throw (runtime_error);
+Cell* operand_quote(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Define a given symbol with a number
@@ -246,7 +368,7 @@ Cell* operand_quote(Cell* const c) throw (runtime_error);
  *
  * \return null always.
  */
-Cell* operand_define(Cell* const c) throw (runtime_error);
+Cell* operand_define(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether the value of a list of numbers monotonically
@@ -256,7 +378,7 @@ Cell* operand_define(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if the above condition holds,
  * otherwise, a pointer to IntCell storing 0.
  */
-Cell* operand_lessthan(Cell* const c) throw (runtime_error);
+Cell* operand_lessthan(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Check whether the value of a cell equals 0 or 0.0.
@@ -265,7 +387,7 @@ Cell* operand_lessthan(Cell* const c) throw (runtime_error);
  * \return A pointer to IntCell storing 1 if the above condition holds,
  * otherwise, a pointer to IntCell storing 0.
  */
-Cell* operand_not(Cell* const c) throw (runtime_error);
+Cell* operand_not(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Print the evaluation result of c to output stream.
@@ -273,7 +395,7 @@ Cell* operand_not(Cell* const c) throw (runtime_error);
  *
  * \return null always.
  */
-Cell* operand_print(Cell* const c) throw (runtime_error);
+Cell* operand_print(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Evaluate c once (cancelling the effect of quote once).
@@ -281,7 +403,7 @@ Cell* operand_print(Cell* const c) throw (runtime_error);
  *
  * \return A pointer to Cell storing the evaluation result.
  */
-Cell* operand_eval(Cell* const c) throw (runtime_error);
+Cell* operand_eval(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Create a ProcedureCell using c as formals and cdr of c as body.
@@ -289,7 +411,7 @@ Cell* operand_eval(Cell* const c) throw (runtime_error);
  *
  * \return A pointer to Cell storing the resulting ProcedureCell.
  */
-Cell* operand_lambda(Cell* const c) throw (runtime_error);
+Cell* operand_lambda(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Apply c to cdr of c.
@@ -297,223 +419,627 @@ Cell* operand_lambda(Cell* const c) throw (runtime_error);
  *
  * \return Result from evaluating the procedure.
  */
-Cell* operand_apply(Cell* const c) throw (runtime_error);
+Cell* operand_apply(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
- * \brief Use a list of argument-value pairs stored in c to apply the cdr of c.
+ * \brief Bind a list of argument-value pairs stored in c in a new frame and
+ * evaluate the cdr of c inside it.
  * (error if c does not hold well-formed arguments).
  *
- * \return Result from evaluating the procedure.
+ * \return Result from evaluating the body.
+ */
+Cell* operand_let(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Wrap the procedure given in c into a memoized procedure, with the
+ * cache capacity given by the optional second argument.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return A pointer to the resulting MemoProcedureCell.
+ */
+Cell* operand_memoize(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Report the cache counters of the memoized procedure given in c.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return A list of hits, misses, cached results and capacity.
+ */
+Cell* operand_memo_stats(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Write the value of the 2nd argument in c to the file named by the
+ * symbol the 1st argument evaluates to, in the binary s-expression format.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return null always.
+ */
+Cell* operand_write_binary(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Read back the value stored in the binary s-expression file named
+ * by the symbol the argument in c evaluates to.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return A pointer to the root of the value read.
+ */
+Cell* operand_read_binary(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Apply the procedure the 1st argument in c evaluates to to every
+ * element of the list the 2nd argument evaluates to, splitting lists of at
+ * least twice the grain size (the optional 3rd argument) into chunks run
+ * in parallel. The procedure may neither define nor print.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return A pointer to the list of results, in the order of the elements.
+ */
+Cell* operand_pmap(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Start evaluating the expression in c on another thread, in a copy
+ * of the bindings visible here. The expression may neither define nor
+ * print.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return A pointer to the FutureCell that will hold the value.
  */
-Cell* operand_let(Cell* const c) throw (runtime_error);
+Cell* operand_future(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Wait for the value of the future the argument in c evaluates to;
+ * any other value is returned as it is.
+ * (error if c does not hold well-formed arguments, or the evaluation of
+ * the future failed).
+ *
+ * \return A pointer to Cell storing the value.
+ */
+Cell* operand_touch(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Combine the elements of the list the 3rd argument in c evaluates
+ * to, followed by the value of the 2nd argument, with the associative
+ * procedure the 1st argument evaluates to. Like reduce in library.scm,
+ * but the combinations form a balanced tree whose subtrees of more than
+ * the grain size (the optional 4th argument) elements run in parallel.
+ * The procedure may neither define nor print.
+ * (error if c does not hold well-formed arguments).
+ *
+ * \return A pointer to Cell storing the result.
+ */
+Cell* operand_preduce(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Print the calls counted by --call-stats so far as a table
+ * (error if c does not hold well-formed arguments, calls are not
+ * counted, or it is evaluated in parallel, where nothing can be printed).
+ *
+ * \return null always.
+ */
+Cell* operand_profile_report(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief The cells made so far on all threads, as one list per type of
+ * (type live made live-bytes bytes-made high-water) (error if c does not
+ * hold well-formed arguments).
+ *
+ * \return A pointer to Cell storing the list.
+ */
+Cell* operand_heap_stats(Interpreter& interp, Cell* const c) throw (runtime_error);
+
+/**
+ * \brief Write the results printed so far to the output stream, and flush
+ * it (error if c does not hold well-formed arguments).
+ *
+ * \return null always.
+ */
+Cell* operand_flush(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 /**
  * \brief Applying a list of arguments to a procedure.
  *
  * \return Result from evaluating the procedure.
  */
-Cell* apply(Cell* const procedure, Cell* const argv_list) throw (runtime_error);
+Cell* apply(Interpreter& interp, Cell* const procedure, Cell* const argv_list) throw (runtime_error);
+
+/**
+ * \brief Applying a list of arguments to a procedure, as apply() does
+ * once it has done the bookkeeping of the profiler.
+ *
+ * \return Result from evaluating the procedure.
+ */
+Cell* apply_procedure(Interpreter& interp, Cell* const procedure, Cell* const argv_list) throw (runtime_error);
+
+/**
+ * \brief Apply a native procedure to a list of arguments, evaluated into
+ * an array (error if their number is not one the procedure takes).
+ *
+ * \return Result from calling the procedure.
+ */
+Cell* apply_native(Interpreter& interp, NativeProcedureCell* const native, Cell* const argv_list) throw (runtime_error);
 
 /**
- * \brief Evaluate all branches of a tree to form a linear list.
+ * \brief Evaluate the statements of a procedure or let body in order.
  *
- * \return Head of the resulting list.
+ * \return Result from evaluating the last statement.
  */
-Cell* my_list(Cell* const c) throw (runtime_error);
+Cell* eval_body(Interpreter& interp, Cell* const body) throw (runtime_error);
 
 /**
- * \brief Transform a list of pair into a linear list containing the left value.
- * i.e. ((a 1) (b 2) (c 3) ...) into (a b c ...)
+ * \brief Evaluate the arguments in argv_list onto the argument stack
+ * (error if their number is not the one of the formal parameters).
  *
- * \return Head of the resulting list.
+ * \return Void.
  */
-Cell* pair_left(Cell* const c) throw (runtime_error);
+void push_arguments(Interpreter& interp, Cell* const formals, Cell* const argv_list) throw (runtime_error);
 
 /**
- * \brief Transform a list of pair into a linear list containing the right value.
- * i.e. ((a 1) (b 2) (c 3) ...) into (1 2 3 ...)
+ * \brief Bind the formal parameters to the arguments on the argument stack
+ * from base up, which are popped, in a new local frame.
  *
- * \return Head of the resulting list.
+ * \return The local frame.
  */
-Cell* pair_right(Cell* const c) throw (runtime_error);
+RefDict* bind_arguments(Interpreter& interp, Cell* const formals, ArgStack::size_type base) throw (runtime_error);
 
-//////////////////////////// Global Variable Initialization ////////////////////////////
+/**
+ * \brief Evaluate the body of procedure in the frame on top of the stack,
+ * above depth. A call of procedure itself in tail position, or as the
+ * cdr of a cons in tail position, replaces the frame and loops instead of
+ * recursing, the conses being linked front to back as they are made.
+ *
+ * \return Result from evaluating the body.
+ */
+Cell* eval_tail(Interpreter& interp, Cell* const procedure, RefStack::size_type depth) throw (runtime_error);
 
-RefDict global_ref(RefDict::SCOPE_GLOBAL);
-RefStack ref_stack = init_stack();
+/**
+ * \brief Look a symbol up through the stack of scopes.
+ *
+ * \return True and its value in value if it is bound, false otherwise.
+ */
+bool find_stack(Interpreter& interp, const string& s, Cell*& value);
+
+/**
+ * \brief Decide the branch of an if with operand list c.
+ *
+ * \return True if the condition is not zero.
+ */
+bool if_test(Interpreter& interp, Cell* const c) throw (runtime_error);
 
 //////////////////////////// Function Definition ////////////////////////////
 // Reminder: Only eval() is not encapsulated
-Cell* eval(Cell* const c)
+Cell* eval(Interpreter& interp, Cell* const c)
 {
   if (nullp(c)) {
     throw runtime_error("trying to evaluate empty or non-cons list");
   } else if (!listp(c)) {
-    return symbolp(c) ? lookup_stack(c) : c;
+    return symbolp(c) ? lookup_stack(interp, c) : c;
+  }
+  if (eval_budget == NULL && interp.limits().any()) {
+    // a top-level expression, charged to a budget of its own
+    shared_ptr<Budget> budget = make_shared<Budget>(interp.limits());
+    BudgetScope scope(budget.get());
+    return eval(interp, c);
   }
-  Cell* temp_c = get_nnfval(c);
-  if (symbolp(temp_c)) {
-    if (temp_c->get_symbol() == "+") {
-      return operand_sum(cdr(c));
+  DepthGuard guard(interp);
+  return dispatch(interp, get_nnfval(interp, c), cdr(c));
+}
+
+Cell* dispatch(Interpreter& interp, Cell* const op, Cell* const c) throw (runtime_error)
+{
+  if (symbolp(op)) {
+    if (profile_enabled) {
+      ProfileFrame frame(op, false);
+      return dispatch_builtin(interp, op, c);
+    }
+    return dispatch_builtin(interp, op, c);
+    
+  } else if (procedurep(op) || nativep(op)) {
+    return apply(interp, op, c);
+    
+  }
+
+  throw runtime_error("cannot apply a value that is not a function");
+}
+
+Cell* dispatch_builtin(Interpreter& interp, Cell* const op, Cell* const c) throw (runtime_error)
+{
+  if (op->get_symbol() == "+") {
+    return operand_sum(interp, c);
+  
+  } else if (op->get_symbol() == "-") {
+    return operand_diff(interp, c);
   
-    } else if (temp_c->get_symbol() == "-") {
-      return operand_diff(cdr(c));
+  } else if (op->get_symbol() == "*") {
+    return operand_product(interp, c);
+    
+  } else if (op->get_symbol() == "/") {
+    return operand_quotient(interp, c);
   
-    } else if (temp_c->get_symbol() == "*") {
-      return operand_product(cdr(c));
-      
-    } else if (temp_c->get_symbol() == "/") {
-      return operand_quotient(cdr(c));
+  } else if (op->get_symbol() == "ceiling") {
+    return operand_ceiling(interp, c);
   
-    } else if (temp_c->get_symbol() == "ceiling") {
-      return operand_ceiling(cdr(c));
+  } else if (op->get_symbol() == "floor") {
+    return operand_floor(interp, c);
   
-    } else if (temp_c->get_symbol() == "floor") {
-      return operand_floor(cdr(c));
+  } else if (op->get_symbol() == "nullp") {
+    return operand_nullp(interp, c);
   
-    } else if (temp_c->get_symbol() == "nullp") {
-      return operand_nullp(cdr(c));
+  } else if (op->get_symbol() == "symbolp") {
+    return operand_symbolp(interp, c);
   
-    } else if (temp_c->get_symbol() == "symbolp") {
-      return operand_symbolp(cdr(c));
+  } else if (op->get_symbol() == "intp") {
+    return operand_intp(interp, c);
+  
+  } else if (op->get_symbol() == "doublep") {
+    return operand_doublep(interp, c);
+    
+  } else if (op->get_symbol() == "listp") {
+    return operand_listp(interp, c);
   
-    } else if (temp_c->get_symbol() == "intp") {
-      return operand_intp(cdr(c));
+  } else if (op->get_symbol() == "procedurep") {
+    return operand_procedurep(interp, c);
   
-    } else if (temp_c->get_symbol() == "doublep") {
-      return operand_doublep(cdr(c));
-      
-    } else if (temp_c->get_symbol() == "listp") {
-      return operand_listp(cdr(c));
+  } else if (op->get_symbol() == "if") {
+    return operand_if(interp, c);
   
-    } else if (temp_c->get_symbol() == "procedurep") {
-      return operand_procedurep(cdr(c));
+  } else if (op->get_symbol() == "cons") {
+    return operand_cons(interp, c);
   
-    } else if (temp_c->get_symbol() == "if") {
-      return operand_if(cdr(c));
+  } else if (op->get_symbol() == "car") {
+    return operand_car(interp, c);
   
-    } else if (temp_c->get_symbol() == "cons") {
-      return operand_cons(cdr(c));
+  } else if (op->get_symbol() == "cdr") {
+    return operand_cdr(interp, c);
   
-    } else if (temp_c->get_symbol() == "car") {
-      return operand_car(cdr(c));
+  } else if (op->get_symbol() == "quote") {
+    return operand_quote(interp, c);
   
-    } else if (temp_c->get_symbol() == "cdr") {
-      return operand_cdr(cdr(c));
+  } else if (op->get_symbol() == "define") {
+    return operand_define(interp, c);
   
-    } else if (temp_c->get_symbol() == "quote") {
-      return operand_quote(cdr(c));
+  } else if (op->get_symbol() == "<") {
+    return operand_lessthan(interp, c);
   
-    } else if (temp_c->get_symbol() == "define") {
-      return operand_define(cdr(c));
+  } else if (op->get_symbol() == "not") {
+    return operand_not(interp, c);
+  
+  } else if (op->get_symbol() == "print") {
+    return operand_print(interp, c);
+  
+  } else if (op->get_symbol() == "eval") {
+    return operand_eval(interp, c);
+  
+  } else if (op->get_symbol() == "lambda") {
+    return operand_lambda(interp, c);
+  
+  } else if (op->get_symbol() == "apply") {
+    return operand_apply(interp, c);
     
-    } else if (temp_c->get_symbol() == "<") {
-      return operand_lessthan(cdr(c));
+  } else if (op->get_symbol() == "let") {
+    return operand_let(interp, c);
     
-    } else if (temp_c->get_symbol() == "not") {
-      return operand_not(cdr(c));
+  } else if (op->get_symbol() == "memoize") {
+    return operand_memoize(interp, c);
     
-    } else if (temp_c->get_symbol() == "print") {
-      return operand_print(cdr(c));
+  } else if (op->get_symbol() == "memo-stats") {
+    return operand_memo_stats(interp, c);
     
-    } else if (temp_c->get_symbol() == "eval") {
-      return operand_eval(cdr(c));
+  } else if (op->get_symbol() == "write-binary") {
+    return operand_write_binary(interp, c);
     
-    } else if (temp_c->get_symbol() == "lambda") {
-      return operand_lambda(cdr(c));
+  } else if (op->get_symbol() == "read-binary") {
+    return operand_read_binary(interp, c);
     
-    } else if (temp_c->get_symbol() == "apply") {
-      return operand_apply(cdr(c));
-      
-    } else if (temp_c->get_symbol() == "let") {
-      return operand_let(cdr(c));
-      
-    }
-  
-  } else if (procedurep(temp_c)) {
-    return apply(temp_c, cdr(c));
+  } else if (op->get_symbol() == "pmap") {
+    return operand_pmap(interp, c);
+    
+  } else if (op->get_symbol() == "future") {
+    return operand_future(interp, c);
+    
+  } else if (op->get_symbol() == "touch") {
+    return operand_touch(interp, c);
+    
+  } else if (op->get_symbol() == "preduce") {
+    return operand_preduce(interp, c);
+    
+  } else if (op->get_symbol() == "profile-report") {
+    return operand_profile_report(interp, c);
+    
+  } else if (op->get_symbol() == "heap-stats") {
+    return operand_heap_stats(interp, c);
+    
+  } else if (op->get_symbol() == "flush") {
+    return operand_flush(interp, c);
     
   }
 
   throw runtime_error("cannot apply a value that is not a function");
 }
 
-RefStack init_stack() throw (runtime_error)
+Cell* lookup_stack(Interpreter& interp, string s) throw (runtime_error)
 {
-  RefStack v;
-  v.push_back(&global_ref);
-  return v;
+  Cell* value;
+  if (!find_stack(interp, s, value)) {
+    throw runtime_error("symbol not found (\"" + s + "\")");
+  }
+  return value;
 }
 
-Cell* lookup_stack(string s) throw (runtime_error)
+bool find_stack(Interpreter& interp, const string& s, Cell*& value)
 {
+  RefStack& ref_stack = interp.ref_stack();
   RefDict::RefIter result;
   for (unsigned i = ref_stack.size(); i-- > 0; ) {
     result = ref_stack[i]->lookup(s);
     if (result != ref_stack[i]->end()) {
-      return result->second;
+      value = result->second;
+      return true;
     }
   }
-  throw runtime_error("symbol not found (\"" + s + "\")");
+  return false;
 }
 
-Cell* lookup_stack(Cell* const c) throw (runtime_error)
+void pop_frames(RefStack& ref_stack, RefStack::size_type depth)
+{
+  while (ref_stack.size() > depth) {
+    delete ref_stack.back();
+    ref_stack.pop_back();
+  }
+}
+
+Cell* lookup_stack(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   if (!symbolp(c)) {
     throw runtime_error("cannot apply a value that is not a function");
   }
-  return lookup_stack(c->get_symbol());
+  return lookup_stack(interp, c->get_symbol());
+}
+
+Cell* apply(Interpreter& interp, Cell* const procedure, Cell* const argv_list) throw (runtime_error)
+{
+  charge_step();
+  // builtins given as procedures get their frame in dispatch()
+  if (profile_enabled && !symbolp(procedure)) {
+    ProfileFrame frame(procedure);
+    return apply_procedure(interp, procedure, argv_list);
+  }
+  return apply_procedure(interp, procedure, argv_list);
 }
 
-Cell* apply(Cell* const procedure, Cell* const argv_list) throw (runtime_error)
+Cell* apply_procedure(Interpreter& interp, Cell* const procedure, Cell* const argv_list) throw (runtime_error)
 {
   if (symbolp(procedure)) {
-    return eval(cons(procedure, listp(argv_list) ? argv_list : cons(argv_list, nil)));
+    // dispatch the builtin directly instead of evaluating a new (procedure . argv_list)
+    Cell* op = lookup_stack(interp, procedure);
+    if (nullp(op)) {
+      throw runtime_error("operation used cannot be done on a null cell");
+    }
+    return dispatch(interp, op, listp(argv_list) ? argv_list : cons(argv_list, nil));
   }
   
-  RefDict* local_ref = new RefDict(RefDict::SCOPE_LOCAL);
-  Cell* formals_list = get_formals(procedure);
-  Cell* body_list = get_body(procedure);
+  if (nativep(procedure)) {
+    return apply_native(interp, get_native(procedure), argv_list);
+  }
+  
+  ArgStack& arg_stack = interp.arg_stack();
+  RefStack& ref_stack = interp.ref_stack();
+  Cell* formals = car(get_formals(procedure));
   
-  Cell* args = car(formals_list);
-  Cell* argv = argv_list;
-  if (symbolp(args)) {
-    local_ref->insert(args, my_list(argv));
+  // Remark: the arguments are evaluated onto arg_stack rather than into a
+  // fresh list, and a frame that fails halfway is unwound on error
+  ArgStack::size_type base = arg_stack.size();
+  RefStack::size_type depth = ref_stack.size();
+  MemoKey* key = NULL;
+  try {
+    push_arguments(interp, formals, argv_list);
     
-  } else if (listp(args)) {
-    int args_size = size(args);
-    int argv_size = size(argv);
-    check_argn(args_size, args_size, argv_size);
-    while (!nullp(args) && !nullp(argv)) {
-      local_ref->insert(car(args), get_fval(argv));
-      args = cdr(args);
-      argv = cdr(argv);
+    MemoCache* memo = NULL;
+    if (memoizedp(procedure)) {
+      memo = get_memo(procedure);
+      key = new MemoKey(arg_stack.begin() + base, arg_stack.end());
+      Cell* cached;
+      if (memo->find(*key, cached)) {
+	delete key;
+	arg_stack.resize(base);
+	return cached;
+      }
     }
     
+    ref_stack.push_back(bind_arguments(interp, formals, base));
+    
+    // Remark: a memoized procedure caches every call, so it does not loop
+    Cell* result;
+    if (memo == NULL) {
+      result = eval_tail(interp, procedure, depth);
+    } else {
+      result = eval_body(interp, get_body(procedure));
+    }
+    pop_frames(ref_stack, depth);
+    
+    if (memo != NULL) {
+      memo->insert(*key, result);
+      delete key;
+    }
+    return result;
+  } catch (runtime_error& e) {
+    delete key;
+    arg_stack.resize(base);
+    pop_frames(ref_stack, depth);
+    throw;
   }
-  ref_stack.push_back(local_ref);
-  
-  Cell* func_statement = body_list;
-  while (!nullp(cdr(func_statement))) {
-    eval(car(func_statement));
-    func_statement = cdr(func_statement);
+}
+
+void push_arguments(Interpreter& interp, Cell* const formals, Cell* const argv_list) throw (runtime_error)
+{
+  ArgStack& arg_stack = interp.arg_stack();
+  if (listp(formals)) {
+    int args_size = size(formals);
+    int argv_size = size(argv_list);
+    check_argn(args_size, args_size, argv_size);
   }
-  
-  func_statement = eval(car(func_statement));
-  local_ref->clear();
-  ref_stack.pop_back();
+  for (Cell* argv = argv_list; !nullp(argv); argv = cdr(argv)) {
+    arg_stack.push_back(get_fval(interp, argv));
+  }
+}
+
+RefDict* bind_arguments(Interpreter& interp, Cell* const formals, ArgStack::size_type base) throw (runtime_error)
+{
+  ArgStack& arg_stack = interp.arg_stack();
+  RefDict* local_ref = new RefDict(RefDict::SCOPE_LOCAL);
+  try {
+    if (symbolp(formals)) {
+      // only a rest parameter needs its arguments as a list
+      Cell* rest = nil;
+      for (ArgStack::size_type i = arg_stack.size(); i-- > base; ) {
+	rest = cons(arg_stack[i], rest);
+      }
+      local_ref->insert(formals, rest);
+    
+    } else if (listp(formals)) {
+      Cell* args = formals;
+      for (ArgStack::size_type i = base; !nullp(args); ++i) {
+	local_ref->insert(car(args), arg_stack[i]);
+	args = cdr(args);
+      }
+    
+    }
+  } catch (runtime_error& e) {
+    delete local_ref;
+    throw;
+  }
+  arg_stack.resize(base);
+  return local_ref;
+}
+
+Cell* eval_tail(Interpreter& interp, Cell* const procedure, RefStack::size_type depth) throw (runtime_error)
+{
+  ArgStack& arg_stack = interp.arg_stack();
+  RefStack& ref_stack = interp.ref_stack();
+  Cell* formals = car(get_formals(procedure));
+  int bound = symbolp(formals) ? 1 : size(formals);
+  // the list built by self calls under cons, and its last cell, whose
+  // cdr is filled in by the next one
+  Cell* head = nil;
+  Cell* hole = NULL;
+  while (true) {
+    Cell* statement = get_body(procedure);
+    while (!nullp(cdr(statement))) {
+      eval(interp, car(statement));
+      statement = cdr(statement);
+    }
     
-  return func_statement;
+    // follow the ifs down to the expression in tail position, held as the
+    // car of position, and find the arguments of a self call there, which
+    // are nil when it has none
+    Cell* position = statement;
+    bool self_call = false;
+    Cell* self_argv = nil;
+    while (position != NULL) {
+      Cell* expr = car(position);
+      Cell* op;
+      if (!listp(expr) || nullp(expr) || !symbolp(car(expr))
+	  || !find_stack(interp, car(expr)->get_symbol(), op)) {
+	break;
+      }
+      if (op == procedure) {
+	self_call = true;
+	self_argv = cdr(expr);
+	break;
+      } else if (!symbolp(op)) {
+	break;
+      } else if (op->get_symbol() == "if") {
+	Cell* c = cdr(expr);
+	int num_arg = size(c);
+	check_argn(2, 3, num_arg);
+	if (if_test(interp, c)) {
+	  position = cdr(c);
+	} else {
+	  // false value is not defined in this case
+	  position = num_arg == 2 ? NULL : cdr(cdr(c));
+	}
+      } else if (op->get_symbol() == "cons") {
+	Cell* c = cdr(expr);
+	check_argn(2, 2, size(c));
+	Cell* tail = car(cdr(c));
+	Cell* tail_op;
+	if (!listp(tail) || nullp(tail) || !symbolp(car(tail))
+	    || !find_stack(interp, car(tail)->get_symbol(), tail_op) || tail_op != procedure) {
+	  break;
+	}
+	Cell* cell = cons(get_fval(interp, c), nil);
+	if (hole == NULL) {
+	  head = cell;
+	} else {
+	  set_cdr(hole, cell);
+	}
+	hole = cell;
+	self_call = true;
+	self_argv = cdr(tail);
+	break;
+      } else {
+	break;
+      }
+    }
+    
+    Cell* result;
+    if (!self_call) {
+      result = position == NULL ? nil : get_fval(interp, position);
+    } else if (ref_stack.back()->size() != bound) {
+      // the body defined names of its own, which the frame of the call
+      // would not hide from it, so the frame cannot be replaced
+      result = apply(interp, procedure, self_argv);
+    } else {
+      ArgStack::size_type base = arg_stack.size();
+      push_arguments(interp, formals, self_argv);
+      pop_frames(ref_stack, depth);
+      ref_stack.push_back(bind_arguments(interp, formals, base));
+      charge_step();
+      if (profile_counting) {
+	// the frame apply() made stays on the shadow stack, while each turn
+	// of the loop is counted as a call of its own
+	leave_call();
+	enter_call(procedure);
+      }
+      continue;
+    }
+    
+    if (hole == NULL) {
+      return result;
+    }
+    set_cdr(hole, result);
+    return head;
+  }
 }
 
-Cell* get_fval(Cell* const c) throw (runtime_error)
+Cell* apply_native(Interpreter& interp, NativeProcedureCell* const native, Cell* const argv_list) throw (runtime_error)
+{
+  int argc = size(argv_list);
+  int max_args = native->max_args();
+  check_argn(native->min_args(), max_args == NativeProcedureCell::VARIADIC ? argc : max_args, argc);
+  // the array is local rather than on the argument stack, as the function
+  // may call back into the interpreter and grow the stack under it
+  Cell* inline_argv[NATIVE_INLINE_ARGS];
+  vector<Cell*> more_argv;
+  Cell** argv = inline_argv;
+  if (argc > NATIVE_INLINE_ARGS) {
+    more_argv.resize(argc);
+    argv = &more_argv[0];
+  }
+  int i = 0;
+  for (Cell* temp_c = argv_list; !nullp(temp_c); temp_c = cdr(temp_c)) {
+    argv[i++] = get_fval(interp, temp_c);
+  }
+  return native->call(interp, argv, argc);
+}
+
+Cell* get_fval(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   if (listp(c)) {
     Cell* c_car = car(c);
     if (listp(c_car)) {
-      c_car = eval(c_car); // recursively evaluate the list
+      c_car = eval(interp, c_car); // recursively evaluate the list
     } else if (symbolp(c_car)) {
-      c_car = lookup_stack(c_car); // search for a symbol
+      c_car = lookup_stack(interp, c_car); // search for a symbol
     }
     return c_car;
   } else {
@@ -521,9 +1047,9 @@ Cell* get_fval(Cell* const c) throw (runtime_error)
   }
 }
 
-Cell* get_nnfval(Cell* const c) throw (runtime_error)
+Cell* get_nnfval(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
-  Cell* temp_c = get_fval(c);
+  Cell* temp_c = get_fval(interp, c);
   if (nullp(temp_c)) {
     throw runtime_error("operation used cannot be done on a null cell");
   } else {
@@ -536,7 +1062,7 @@ Cell* make_num(bool& is_int, double n) throw (runtime_error)
   return is_int ? make_int((int) n) : make_double(n);
 }
 
-Cell* operand_sum(Cell* const c) throw (runtime_error)
+Cell* operand_sum(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   Cell* temp_c = c;
   bool is_result_int = true; // assuming all cells to be summed stores int
@@ -545,14 +1071,14 @@ Cell* operand_sum(Cell* const c) throw (runtime_error)
   // loop through the list starting from c
   while (!nullp(temp_c)) {
     // ensure that the temp_c is completely evaluated, then add it to sum
-    get_nnfval(temp_c)->add_to(is_result_int, sum);
+    get_nnfval(interp, temp_c)->add_to(is_result_int, sum);
     temp_c = cdr(temp_c);
   }
   
   return make_num(is_result_int, sum);
 }
 
-Cell* operand_diff(Cell* const c) throw (runtime_error)
+Cell* operand_diff(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   if (nullp(c)) {
     throw runtime_error("at least one operand should be given for -");
@@ -563,21 +1089,21 @@ Cell* operand_diff(Cell* const c) throw (runtime_error)
   double diff = 0; // accumulative
   
   if (nullp(cdr(c))) {
-    get_nnfval(temp_c)->subtract_from(is_result_int, diff);
+    get_nnfval(interp, temp_c)->subtract_from(is_result_int, diff);
   } else {
-    get_nnfval(temp_c)->add_to(is_result_int, diff);
+    get_nnfval(interp, temp_c)->add_to(is_result_int, diff);
     temp_c = cdr(temp_c);
     // loop through the list starting from c
     while (!nullp(temp_c)) {
       // ensure that the temp_c is completely evaluated, then subtract it from diff
-      get_nnfval(temp_c)->subtract_from(is_result_int, diff);
+      get_nnfval(interp, temp_c)->subtract_from(is_result_int, diff);
       temp_c = cdr(temp_c);
     }
   }
   return make_num(is_result_int, diff);
 }
 
-Cell* operand_product(Cell* const c) throw (runtime_error)
+Cell* operand_product(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   Cell* temp_c = c;
   bool is_result_int = true; // assuming all cells to be multiplied stores int
@@ -586,14 +1112,14 @@ Cell* operand_product(Cell* const c) throw (runtime_error)
   // loop through the list starting from c
   while (!nullp(temp_c)) {
     // ensure that the temp_c is completely evaluated, then multiply it to product
-    get_nnfval(temp_c)->multiply_to(is_result_int, product);
+    get_nnfval(interp, temp_c)->multiply_to(is_result_int, product);
     temp_c = cdr(temp_c);
   }
   
   return make_num(is_result_int, product);
 }
 
-Cell* operand_quotient(Cell* const c) throw (runtime_error)
+Cell* operand_quotient(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   if (nullp(c)) {
     throw runtime_error("at least one operand should be given for /");
@@ -604,14 +1130,14 @@ Cell* operand_quotient(Cell* const c) throw (runtime_error)
   double quotient = 1; // accumulative
   
   if (nullp(cdr(c))) {
-    get_nnfval(temp_c)->divide_from(is_result_int, quotient);
+    get_nnfval(interp, temp_c)->divide_from(is_result_int, quotient);
   } else {
-    get_nnfval(temp_c)->multiply_to(is_result_int, quotient);
+    get_nnfval(interp, temp_c)->multiply_to(is_result_int, quotient);
     temp_c = cdr(temp_c);
     // loop through the list starting from c
     while (!nullp(temp_c)) {
       // ensure that the temp_c is completely evaluated, then divide it into quotient
-      get_nnfval(temp_c)->divide_from(is_result_int, quotient);
+      get_nnfval(interp, temp_c)->divide_from(is_result_int, quotient);
       temp_c = cdr(temp_c);
     }
   }
@@ -619,104 +1145,117 @@ Cell* operand_quotient(Cell* const c) throw (runtime_error)
   return make_num(is_result_int, quotient);
 }
 
-Cell* operand_ceiling(Cell* const c) throw (runtime_error)
+Cell* operand_ceiling(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return get_nnfval(c)->ceiling();
+  return get_nnfval(interp, c)->ceiling();
 }
 
-Cell* operand_floor(Cell* const c) throw (runtime_error)
+Cell* operand_floor(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return get_nnfval(c)->floor();
+  return get_nnfval(interp, c)->floor();
 }
 
-Cell* operand_nullp(Cell* const c) throw (runtime_error)
+Cell* operand_nullp(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return nullp(get_fval(c)) ? make_int(1) : make_int(0);
+  return nullp(get_fval(interp, c)) ? make_int(1) : make_int(0);
 }
 
-Cell* operand_symbolp(Cell* const c) throw (runtime_error)
+Cell* operand_symbolp(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return symbolp(get_fval(c)) ? make_int(1) : make_int(0);
+  return symbolp(get_fval(interp, c)) ? make_int(1) : make_int(0);
 }
 
-Cell* operand_intp(Cell* const c) throw (runtime_error)
+Cell* operand_intp(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return intp(get_fval(c)) ? make_int(1) : make_int(0);
+  return intp(get_fval(interp, c)) ? make_int(1) : make_int(0);
 }
 
-Cell* operand_doublep(Cell* const c) throw (runtime_error)
+Cell* operand_doublep(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return doublep(get_fval(c)) ? make_int(1) : make_int(0);
+  return doublep(get_fval(interp, c)) ? make_int(1) : make_int(0);
 }
 
-Cell* operand_listp(Cell* const c) throw (runtime_error)
+Cell* operand_listp(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return listp(get_fval(c)) ? make_int(1) : make_int(0);
+  return listp(get_fval(interp, c)) ? make_int(1) : make_int(0);
 }
 
-Cell* operand_procedurep(Cell* const c) throw (runtime_error)
+Cell* operand_procedurep(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return procedurep(get_fval(c)) ? make_int(1) : make_int(0);
+  Cell* value = get_fval(interp, c);
+  return procedurep(value) || nativep(value) ? make_int(1) : make_int(0);
 }
 
 // Remark: (if (quote ()) a b) gives error instead of a
-Cell* operand_if(Cell* const c) throw (runtime_error)
+Cell* operand_if(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   int num_arg = size(c);
   check_argn(2, 3, num_arg);
-  // Remark: Both IntCell and DoubleCell can call get_double()
-  // in order to get its value as a double
-  if (get_fval(c)->get_double()) {
-    return get_fval(cdr(c));
+  if (if_test(interp, c)) {
+    return get_fval(interp, cdr(c));
   } else {
     // false value is not defined in this case
-    return num_arg == 2 ? nil : get_fval(cdr(cdr(c))); 
+    return num_arg == 2 ? nil : get_fval(interp, cdr(cdr(c))); 
   }
 }
 
-Cell* operand_cons(Cell* const c) throw (runtime_error)
+bool if_test(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  // Remark: Both IntCell and DoubleCell can call get_double()
+  // in order to get its value as a double
+  return get_fval(interp, c)->get_double() != 0;
+}
+
+Cell* operand_cons(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(2, 2, size(c));
-  return cons(get_fval(c), get_fval(cdr(c)));
+  return cons(get_fval(interp, c), get_fval(interp, cdr(c)));
 }
 
-Cell* operand_car(Cell* const c) throw (runtime_error)
+Cell* operand_car(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return car(get_fval(c));
+  return car(get_fval(interp, c));
 }
 
-Cell* operand_cdr(Cell* const c) throw (runtime_error)
+Cell* operand_cdr(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return cdr(get_nnfval(c));
+  return cdr(get_nnfval(interp, c));
 }
 
-Cell* operand_quote(Cell* const c) throw (runtime_error)
+Cell* operand_quote(Interpreter&, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
   return car(c);
 }
 
-Cell* operand_define(Cell* const c) throw (runtime_error)
+Cell* operand_define(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(2, 2, size(c));
+  if (interp.pure()) {
+    throw runtime_error("define cannot be used by code evaluated in parallel");
+  }
   if (nullp(car(c))) {
     throw runtime_error("defining null");
   }
-  ref_stack.back()->insert(car(c), get_fval(cdr(c)));
+  Cell* value = get_fval(interp, cdr(c));
+  interp.ref_stack().back()->insert(car(c), value);
+  if (procedurep(value) || nativep(value)) {
+    value->set_name(car(c)); // for profiles
+  }
   return nil;
 }
 
-Cell* operand_lessthan(Cell* const c) throw (runtime_error)
+Cell* operand_lessthan(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   Cell* temp_c = c; // looper
   Cell* cur; // current cell value
@@ -725,13 +1264,13 @@ Cell* operand_lessthan(Cell* const c) throw (runtime_error)
   // Go through the list
   while (!nullp(temp_c)) {
     // Validate the current cell
-    cur = get_nnfval(temp_c);
+    cur = get_nnfval(interp, temp_c);
     if(!intp(cur) && !doublep(cur) && !symbolp(cur)) {
       throw runtime_error("only symbol, int or double cell can be compared");
     }
     // Validate the next cell
     if (!nullp(cdr(temp_c))) {
-      next = get_nnfval(cdr(temp_c));
+      next = get_nnfval(interp, cdr(temp_c));
       if (!intp(next) && !doublep(next) && !symbolp(next)) {
 	throw runtime_error("only symbol, int or double cell can be compared");
       }
@@ -753,10 +1292,10 @@ Cell* operand_lessthan(Cell* const c) throw (runtime_error)
   return result ? make_int(1) : make_int(0);
 }
 
-Cell* operand_not(Cell* const c) throw (runtime_error)
+Cell* operand_not(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  Cell* fval = get_fval(c);
+  Cell* fval = get_fval(interp, c);
   if ((intp(fval) && !fval->get_int()) || (doublep(fval) && !fval->get_double())) {
     return make_int(1);
   } else {
@@ -764,59 +1303,369 @@ Cell* operand_not(Cell* const c) throw (runtime_error)
   }
 }
 
-Cell* operand_print(Cell* const c) throw (runtime_error)
+Cell* operand_print(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  Cell* temp_c = eval(car(c));
-  if (!nullp(temp_c)) {
-    temp_c->print(cout);
-  } else {
-    cout << "()";
+  if (interp.pure()) {
+    throw runtime_error("print cannot be used by code evaluated in parallel");
   }
-  cout << endl;
+  interp.out_buffer().print_line(eval(interp, car(c)));
   return nil;
 }
 
-Cell* operand_eval(Cell* const c) throw (runtime_error)
+Cell* operand_eval(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(1, 1, size(c));
-  return eval(get_nnfval(c));
+  return eval(interp, get_nnfval(interp, c));
 }
 
-Cell* operand_lambda(Cell* const c) throw (runtime_error)
+Cell* operand_lambda(Interpreter&, Cell* const c) throw (runtime_error)
 {
   check_argn(2, size(c));
   return lambda(c, cdr(c));
 }
 
-Cell* operand_apply(Cell* const c) throw (runtime_error)
+Cell* operand_apply(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(2, 2, size(c));
-  return apply(lookup_stack(car(c)), eval(car(cdr(c))));
+  return apply(interp, lookup_stack(interp, car(c)), eval(interp, car(cdr(c))));
 }
 
-Cell* operand_let(Cell* const c) throw (runtime_error)
+Cell* operand_let(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
   check_argn(2, size(c));
-  if (!listp(car(c)) || !listp(car(car(c)))) {
+  if (!listp(car(c))) {
     throw runtime_error("cannot apply a value that is not a function");
   }
-  RefDict local_ref = RefDict(RefDict::SCOPE_LOCAL);
-  Cell* pair_list = car(c);
-  return apply(lambda(cons(pair_left(pair_list), nil), cdr(c)), pair_right(pair_list));
+  
+  // Remark: the values are evaluated in the enclosing scope before any of
+  // them is bound, then the body runs in place without a ProcedureCell
+  ArgStack& arg_stack = interp.arg_stack();
+  RefStack& ref_stack = interp.ref_stack();
+  ArgStack::size_type base = arg_stack.size();
+  RefStack::size_type depth = ref_stack.size();
+  try {
+    for (Cell* pair_list = car(c); !nullp(pair_list); pair_list = cdr(pair_list)) {
+      Cell* pair = car(pair_list);
+      if (!listp(pair) || size(pair) != 2 || !symbolp(car(pair))) {
+	throw runtime_error("let binding should be a pair of symbol and value");
+      }
+      arg_stack.push_back(get_fval(interp, cdr(pair)));
+    }
+    
+    RefDict* local_ref = new RefDict(RefDict::SCOPE_LOCAL);
+    ArgStack::size_type i = base;
+    for (Cell* pair_list = car(c); !nullp(pair_list); pair_list = cdr(pair_list)) {
+      local_ref->insert(car(car(pair_list)), arg_stack[i++]);
+    }
+    arg_stack.resize(base);
+    ref_stack.push_back(local_ref);
+    
+    Cell* result = eval_body(interp, cdr(c));
+    pop_frames(ref_stack, depth);
+    
+    return result;
+  } catch (runtime_error& e) {
+    arg_stack.resize(base);
+    pop_frames(ref_stack, depth);
+    throw;
+  }
 }
 
-Cell* my_list(Cell* const c) throw (runtime_error)
+Cell* eval_body(Interpreter& interp, Cell* const body) throw (runtime_error)
 {
-  return nullp(c) ? c : cons(get_fval(c), my_list(cdr(c)));
+  Cell* statement = body;
+  while (!nullp(cdr(statement))) {
+    eval(interp, car(statement));
+    statement = cdr(statement);
+  }
+  return eval(interp, car(statement));
 }
 
-Cell* pair_left(Cell* const c) throw (runtime_error)
+Cell* operand_memoize(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
-  return nullp(c) ? c : cons(car(car(c)), pair_left(cdr(c)));
+  int num_arg = size(c);
+  check_argn(1, 2, num_arg);
+  Cell* procedure = get_nnfval(interp, c);
+  if (!procedurep(procedure)) {
+    throw runtime_error("only a procedure can be memoized");
+  }
+  int capacity = MemoCache::DEFAULT_CAPACITY;
+  if (num_arg == 2) {
+    Cell* temp_c = get_nnfval(interp, cdr(c));
+    if (!intp(temp_c) || temp_c->get_int() < 1) {
+      throw runtime_error("memoize capacity should be a positive int");
+    }
+    capacity = temp_c->get_int();
+  }
+  return memoize(get_formals(procedure), get_body(procedure), capacity);
 }
 
-Cell* pair_right(Cell* const c) throw (runtime_error)
+Cell* operand_memo_stats(Interpreter& interp, Cell* const c) throw (runtime_error)
 {
-  return nullp(c) ? c : cons(get_fval(cdr(car(c))), pair_right(cdr(c)));
+  check_argn(1, 1, size(c));
+  Cell* procedure = get_fval(interp, c);
+  if (!memoizedp(procedure)) {
+    throw runtime_error("memo-stats expects a memoized procedure");
+  }
+  MemoCache* memo = get_memo(procedure);
+  return cons(make_int(memo->hits()),
+	      cons(make_int(memo->misses()),
+		   cons(make_int(memo->size()),
+			cons(make_int(memo->capacity()), nil))));
+}
+
+Cell* operand_write_binary(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  check_argn(2, 2, size(c));
+  Cell* path = get_nnfval(interp, c);
+  if (!symbolp(path)) {
+    throw runtime_error("file name should be given as a symbol");
+  }
+  write_binary_file(path->get_symbol().c_str(), get_fval(interp, cdr(c)));
+  return nil;
+}
+
+Cell* operand_read_binary(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  check_argn(1, 1, size(c));
+  Cell* path = get_nnfval(interp, c);
+  if (!symbolp(path)) {
+    throw runtime_error("file name should be given as a symbol");
+  }
+  return read_binary_file(path->get_symbol().c_str());
+}
+
+/**
+ * \brief Number of elements below which pmap and preduce do not split a
+ * chunk any further, unless another grain size is given.
+ */
+const int PMAP_GRAIN = 64;
+
+ThreadPool& worker_pool()
+{
+  static ThreadPool pool(max(1u, thread::hardware_concurrency()));
+  return pool;
+}
+
+/**
+ * \brief Replace items[begin..end) by the results of applying procedure to
+ * them, with define and print rejected.
+ * \return Void.
+ */
+void pmap_chunk(Interpreter& interp, Cell* const procedure, vector<Cell*>& items,
+		vector<Cell*>::size_type begin, vector<Cell*>::size_type end) throw (runtime_error)
+{
+  bool was_pure = interp.set_pure(true);
+  Cell* quote = make_symbol("quote");
+  try {
+    for (vector<Cell*>::size_type i = begin; i < end; ++i) {
+      // quote the element so that apply does not evaluate it once more
+      items[i] = apply(interp, procedure, cons(cons(quote, cons(items[i], nil)), nil));
+    }
+  } catch (runtime_error& e) {
+    interp.set_pure(was_pure);
+    throw;
+  }
+  interp.set_pure(was_pure);
+}
+
+Cell* operand_pmap(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  int num_arg = size(c);
+  check_argn(2, 3, num_arg);
+  Cell* procedure = get_nnfval(interp, c);
+  if (!procedurep(procedure) && !nativep(procedure) && !symbolp(procedure)) {
+    throw runtime_error("pmap expects a procedure");
+  }
+  Cell* list = get_fval(interp, cdr(c));
+  if (!nullp(list) && !listp(list)) {
+    throw runtime_error("pmap expects a list");
+  }
+  int grain = PMAP_GRAIN;
+  if (num_arg == 3) {
+    Cell* temp_c = get_nnfval(interp, cdr(cdr(c)));
+    if (!intp(temp_c) || temp_c->get_int() < 1) {
+      throw runtime_error("pmap grain size should be a positive int");
+    }
+    grain = temp_c->get_int();
+  }
+  
+  vector<Cell*> items;
+  for (Cell* temp_c = list; !nullp(temp_c); temp_c = cdr(temp_c)) {
+    items.push_back(car(temp_c));
+  }
+  
+  ThreadPool& pool = worker_pool();
+  vector<Cell*>::size_type chunks = min(items.size() / grain, (vector<Cell*>::size_type) pool.threads() * 4);
+  if (chunks < 2) {
+    pmap_chunk(interp, procedure, items, 0, items.size());
+  } else {
+    // every chunk runs on its own interpreter seeded with the bindings
+    // visible here, so that dynamically scoped free variables resolve; it
+    // cannot print, and must not touch the output buffer of this one
+    vector<ThreadPool::Task> tasks;
+    shared_ptr<Budget> budget = share_budget();
+    for (vector<Cell*>::size_type i = 0; i < chunks; ++i) {
+      vector<Cell*>::size_type begin = items.size() * i / chunks;
+      vector<Cell*>::size_type end = items.size() * (i + 1) / chunks;
+      tasks.push_back([&interp, &items, budget, procedure, begin, end] {
+	  BudgetScope scope(budget.get());
+	  Interpreter worker(interp, Interpreter::discard(), Interpreter::discard());
+	  pmap_chunk(worker, procedure, items, begin, end);
+	});
+    }
+    pool.run(tasks);
+  }
+  
+  Cell* result = nil;
+  for (vector<Cell*>::size_type i = items.size(); i-- > 0; ) {
+    result = cons(items[i], result);
+  }
+  return result;
+}
+
+Cell* operand_future(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  check_argn(1, 1, size(c));
+  // the future may run after the streams of interp are gone
+  shared_ptr<Interpreter> worker(new Interpreter(interp, Interpreter::discard(), Interpreter::discard()));
+  worker->set_pure(true);
+  shared_ptr<Budget> budget = share_budget();
+  FutureCell* future = make_future([worker, budget, c] {
+      BudgetScope scope(budget.get());
+      return get_fval(*worker, c);
+    });
+  worker_pool().submit([future] { future->run(); });
+  return future;
+}
+
+Cell* operand_touch(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  check_argn(1, 1, size(c));
+  Cell* value = get_fval(interp, c);
+  return futurep(value) ? touch(value) : value;
+}
+
+/**
+ * \brief Combine items[begin..end), which must not be empty, with
+ * procedure in a balanced tree, splitting subtrees of more than leaf
+ * items over the worker pool.
+ * \return The combined value.
+ */
+Cell* preduce_range(Interpreter& interp, Cell* const procedure, const vector<Cell*>& items,
+		    vector<Cell*>::size_type begin, vector<Cell*>::size_type end,
+		    vector<Cell*>::size_type leaf) throw (runtime_error)
+{
+  Cell* quote = make_symbol("quote");
+  if (end - begin <= leaf) {
+    Cell* result = items[begin];
+    for (vector<Cell*>::size_type i = begin + 1; i < end; ++i) {
+      result = apply(interp, procedure, cons(cons(quote, cons(result, nil)),
+					     cons(cons(quote, cons(items[i], nil)), nil)));
+    }
+    return result;
+  }
+  
+  // both halves run on their own interpreter, as this one may take part
+  // in evaluating either of them
+  vector<Cell*>::size_type middle = begin + (end - begin) / 2;
+  Cell* left = nil;
+  Cell* right = nil;
+  vector<ThreadPool::Task> tasks;
+  Budget* budget = eval_budget;
+  tasks.push_back([&interp, &items, &left, budget, procedure, begin, middle, leaf] {
+      BudgetScope scope(budget);
+      Interpreter worker(interp, Interpreter::discard(), Interpreter::discard());
+      left = preduce_range(worker, procedure, items, begin, middle, leaf);
+    });
+  tasks.push_back([&interp, &items, &right, budget, procedure, middle, end, leaf] {
+      BudgetScope scope(budget);
+      Interpreter worker(interp, Interpreter::discard(), Interpreter::discard());
+      right = preduce_range(worker, procedure, items, middle, end, leaf);
+    });
+  worker_pool().run(tasks);
+  return apply(interp, procedure, cons(cons(quote, cons(left, nil)),
+				       cons(cons(quote, cons(right, nil)), nil)));
+}
+
+Cell* operand_preduce(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  int num_arg = size(c);
+  check_argn(3, 4, num_arg);
+  Cell* procedure = get_nnfval(interp, c);
+  if (!procedurep(procedure) && !nativep(procedure) && !symbolp(procedure)) {
+    throw runtime_error("preduce expects a procedure");
+  }
+  Cell* init = get_fval(interp, cdr(c));
+  Cell* list = get_fval(interp, cdr(cdr(c)));
+  if (!nullp(list) && !listp(list)) {
+    throw runtime_error("preduce expects a list");
+  }
+  int grain = PMAP_GRAIN;
+  if (num_arg == 4) {
+    Cell* temp_c = get_nnfval(interp, cdr(cdr(cdr(c))));
+    if (!intp(temp_c) || temp_c->get_int() < 1) {
+      throw runtime_error("preduce grain size should be a positive int");
+    }
+    grain = temp_c->get_int();
+  }
+  
+  vector<Cell*> items;
+  for (Cell* temp_c = list; !nullp(temp_c); temp_c = cdr(temp_c)) {
+    items.push_back(car(temp_c));
+  }
+  items.push_back(init);
+  
+  // no more leaves than needed to keep every thread busy
+  vector<Cell*>::size_type leaf = max((vector<Cell*>::size_type) grain,
+				      items.size() / (worker_pool().threads() * 4) + 1);
+  bool was_pure = interp.set_pure(true);
+  try {
+    Cell* result = preduce_range(interp, procedure, items, 0, items.size(), leaf);
+    interp.set_pure(was_pure);
+    return result;
+  } catch (runtime_error& e) {
+    interp.set_pure(was_pure);
+    throw;
+  }
+}
+
+Cell* operand_profile_report(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  check_argn(0, 0, size(c));
+  if (interp.pure()) {
+    throw runtime_error("profile-report cannot be used by code evaluated in parallel");
+  }
+  if (!profile_counting) {
+    throw runtime_error("profile-report needs calls to be counted (--call-stats)");
+  }
+  write_call_stats(interp.out(), false);
+  return nil;
+}
+
+Cell* operand_heap_stats(Interpreter&, Cell* const c) throw (runtime_error)
+{
+  check_argn(0, 0, size(c));
+  HeapStats stats[HEAP_TYPES];
+  heap_stats(stats);
+  Cell* result = nil;
+  for (int t = HEAP_TYPES; t-- > 0; ) {
+    const HeapStats& s = stats[t];
+    result = cons(cons(make_symbol(s.type),
+		       cons(make_int(s.live),
+			    cons(make_int(s.made),
+				 cons(make_int(s.live_bytes),
+				      cons(make_int(s.bytes_made),
+					   cons(make_int(s.high_water), nil)))))),
+		  result);
+  }
+  return result;
+}
+
+Cell* operand_flush(Interpreter& interp, Cell* const c) throw (runtime_error)
+{
+  check_argn(0, 0, size(c));
+  interp.out_buffer().flush();
+  return nil;
 }
@@ -8,15 +8,25 @@
 #define EVAL_HPP
 
 #include "cons.hpp"
+#include "Interpreter.hpp"
+#include "ThreadPool.hpp"
 
 using namespace std;
 
 /**
  * \brief Evaluate the expression tree whose root is pointed to by c
+ * within the interpreter interp
  * (error if c does not hold a well-formed expression).
  *
  * \return The value resulting from evaluating the expression.
  */
-Cell* eval(Cell* const c);
+Cell* eval(Interpreter& interp, Cell* const c);
+
+/**
+ * \brief The pool shared by pmap, preduce, futures and the requests of the
+ * server, one thread per core.
+ * \return The pool.
+ */
+ThreadPool& worker_pool();
 
 #endif // EVAL_HPP
@@ -1,4 +1,5 @@
 #include "cons.hpp"
+#include "number.hpp"
 #include <string>
 #include <stdexcept>
 
@@ -31,9 +32,9 @@ int size(Cell* const c) throw (runtime_error)
  */
 string to_str(int i) throw (runtime_error)
 {
-  ostringstream oss;
-  oss << i;
-  return oss.str();
+  string str;
+  append_int(str, i);
+  return str;
 }
 /**
  * \brief Check whether the number of argument(s) matches the given range.
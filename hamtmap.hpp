@@ -0,0 +1,459 @@
+/**
+ * \file hamtmap.hpp
+ *
+ * Template library of a persistent map, a hash array mapped trie. Its
+ * nodes are never changed once built: an update copies the path from the
+ * root to the entry and shares the rest with the map before it. Copying a
+ * map therefore takes constant time, and gives a snapshot that later
+ * updates to either copy do not reach; the nodes are reference counted
+ * atomically, so copies may be read and updated on different threads.
+ *
+ */
+
+#ifndef HAMTMAP_HPP
+#define HAMTMAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * \class hamtmap
+ * \brief Template class hamtmap. Every node holds up to 32 slots, indexed
+ * by the next 5 bits of the hash of the key and stored compactly behind a
+ * bitmap; a slot holds either an entry or the node below. The entries
+ * whose hashes are equal in all bits end in one collision node.
+ */
+template <class Key, class T, class Hash = std::hash<Key> >
+class hamtmap
+{
+  typedef hamtmap<Key, T, Hash>                                  Self;
+
+public:
+  class iterator;
+
+  typedef Key                                                    key_type;
+  typedef T                                                      data_type;
+  typedef T                                                      mapped_type;
+  typedef std::pair<Key, T>                                      value_type;
+  typedef std::size_t                                            size_type;
+  typedef iterator                                               const_iterator;
+
+private:
+  struct Node;
+  typedef std::shared_ptr<const Node>                            NodePtr;
+
+  static const int BITS = 5;
+  static const std::size_t MASK = (1 << BITS) - 1;
+  static const int HASH_BITS = sizeof(std::size_t) * 8;
+  static const int MAX_DEPTH = HASH_BITS / BITS + 2;
+
+  /**
+   * \brief A slot of a node: the node below, or else an entry.
+   */
+  struct Slot {
+    NodePtr child;
+    std::size_t hash;
+    value_type entry;
+  };
+
+  /**
+   * \brief A node: the slots present in bitmap, in the order of their
+   * bits; or, for a collision node, entries of one hash in any order.
+   */
+  struct Node {
+    unsigned int bitmap;
+    bool collision;
+    std::vector<Slot> slots;
+  };
+
+  /**
+   * \brief Number of slots present below bit in bitmap, which is where the
+   * slot of bit is stored.
+   * \return The position of the slot.
+   */
+  static int position(unsigned int bitmap, unsigned int bit)
+  {
+    return __builtin_popcount(bitmap & (bit - 1));
+  }
+
+  /**
+   * \brief Build the node at depth shift holding the two entries a and b
+   * of different keys.
+   * \return The node.
+   */
+  static NodePtr merge(int shift, const Slot& a, const Slot& b)
+  {
+    std::shared_ptr<Node> node = std::make_shared<Node>();
+    if (shift >= HASH_BITS) {
+      node->bitmap = 0;
+      node->collision = true;
+      node->slots.push_back(a);
+      node->slots.push_back(b);
+      return node;
+    }
+    node->collision = false;
+    std::size_t index_a = (a.hash >> shift) & MASK;
+    std::size_t index_b = (b.hash >> shift) & MASK;
+    if (index_a == index_b) {
+      Slot slot;
+      slot.child = merge(shift + BITS, a, b);
+      slot.hash = 0;
+      node->bitmap = 1U << index_a;
+      node->slots.push_back(slot);
+    } else {
+      node->bitmap = (1U << index_a) | (1U << index_b);
+      node->slots.push_back(index_a < index_b ? a : b);
+      node->slots.push_back(index_a < index_b ? b : a);
+    }
+    return node;
+  }
+
+  /**
+   * \brief Bind the key of slot to its value in the subtree of node at
+   * depth shift, replacing any binding (replace) or keeping it.
+   * \return The root of the updated subtree, node itself if unchanged;
+   * added tells whether the key was new.
+   */
+  static NodePtr update(const NodePtr& node, int shift, const Slot& slot, bool replace, bool& added)
+  {
+    if (node->collision) {
+      for (std::size_t i = 0; i < node->slots.size(); ++i) {
+	if (node->slots[i].entry.first == slot.entry.first) {
+	  if (!replace) {
+	    return node;
+	  }
+	  std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+	  copy->slots[i] = slot;
+	  return copy;
+	}
+      }
+      std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+      copy->slots.push_back(slot);
+      added = true;
+      return copy;
+    }
+
+    unsigned int bit = 1U << ((slot.hash >> shift) & MASK);
+    int pos = position(node->bitmap, bit);
+    if (!(node->bitmap & bit)) {
+      std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+      copy->bitmap |= bit;
+      copy->slots.insert(copy->slots.begin() + pos, slot);
+      added = true;
+      return copy;
+    }
+
+    const Slot& present = node->slots[pos];
+    NodePtr child;
+    if (present.child) {
+      child = update(present.child, shift + BITS, slot, replace, added);
+      if (child == present.child) {
+	return node;
+      }
+    } else if (present.hash == slot.hash && present.entry.first == slot.entry.first) {
+      if (!replace) {
+	return node;
+      }
+      std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+      copy->slots[pos] = slot;
+      return copy;
+    } else {
+      child = merge(shift + BITS, present, slot);
+      added = true;
+    }
+    std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+    copy->slots[pos].child = child;
+    copy->slots[pos].hash = 0;
+    copy->slots[pos].entry = value_type();
+    return copy;
+  }
+
+  /**
+   * \brief Bind the key of slot to its value.
+   * \return Whether the key was new.
+   */
+  bool update(const Slot& slot, bool replace)
+  {
+    bool added = false;
+    if (!root_m) {
+      std::shared_ptr<Node> node = std::make_shared<Node>();
+      node->bitmap = 0;
+      node->collision = false;
+      root_m = node;
+    }
+    root_m = update(root_m, 0, slot, replace, added);
+    if (added) {
+      ++size_m;
+    }
+    return added;
+  }
+
+  /**
+   * \brief Make the slot of an entry.
+   * \return The slot.
+   */
+  Slot make_slot(const value_type& entry) const
+  {
+    Slot slot;
+    slot.hash = hash_m(entry.first);
+    slot.entry = entry;
+    return slot;
+  }
+
+public:
+
+  /**
+   * \class iterator
+   * \brief The position of an entry, with the path of nodes down to it.
+   * The map is never changed in place, so an iterator stays valid as long
+   * as the nodes it was taken from are in some copy of the map.
+   */
+  class iterator
+    : public std::iterator<std::forward_iterator_tag, const value_type>
+  {
+    friend class hamtmap;
+
+  public:
+
+    /**
+     * \brief Constructor of the end iterator.
+     */
+    iterator()
+      : depth_m(0)
+    {
+
+    }
+
+    /**
+     * \brief Accessor.
+     * \return The entry.
+     */
+    const value_type& operator*() const
+    {
+      return current().entry;
+    }
+
+    /**
+     * \brief Accessor.
+     * \return A pointer to the entry.
+     */
+    const value_type* operator->() const
+    {
+      return &current().entry;
+    }
+
+    /**
+     * \brief Move to the next entry, in no particular order.
+     * \return This iterator.
+     */
+    iterator& operator++()
+    {
+      ++index_m[depth_m - 1];
+      settle();
+      return *this;
+    }
+
+    /**
+     * \brief Move to the next entry, in no particular order.
+     * \return A copy of this iterator from before.
+     */
+    iterator operator++(int)
+    {
+      iterator before = *this;
+      ++*this;
+      return before;
+    }
+
+    /**
+     * \brief Compare with another iterator.
+     * \return True if both are at the same entry, or both at the end.
+     */
+    bool operator==(const iterator& other) const
+    {
+      if (depth_m == 0 || other.depth_m == 0) {
+	return depth_m == other.depth_m;
+      }
+      return &current() == &other.current();
+    }
+
+    /**
+     * \brief Compare with another iterator.
+     * \return True if they are at different entries.
+     */
+    bool operator!=(const iterator& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+
+    /**
+     * \brief Accessor.
+     * \return The slot of the entry.
+     */
+    const Slot& current() const
+    {
+      return node_m[depth_m - 1]->slots[index_m[depth_m - 1]];
+    }
+
+    /**
+     * \brief Go down into child nodes and up out of finished ones until
+     * the path ends at an entry, or is empty at the end of the map.
+     * \return Void.
+     */
+    void settle()
+    {
+      while (depth_m > 0) {
+	const Node* node = node_m[depth_m - 1];
+	std::size_t index = index_m[depth_m - 1];
+	if (index == node->slots.size()) {
+	  if (--depth_m > 0) {
+	    ++index_m[depth_m - 1];
+	  }
+	} else if (node->slots[index].child) {
+	  node_m[depth_m] = node->slots[index].child.get();
+	  index_m[depth_m] = 0;
+	  ++depth_m;
+	} else {
+	  return;
+	}
+      }
+    }
+
+    const Node* node_m[MAX_DEPTH];
+    std::size_t index_m[MAX_DEPTH];
+    int depth_m;
+  };
+
+  /**
+   * \brief Constructor of an empty map.
+   */
+  hamtmap()
+    : size_m(0)
+  {
+
+  }
+
+  /**
+   * \brief Look up key.
+   * \return The iterator of its entry, end() if it is not in the map.
+   */
+  iterator find(const Key& key) const
+  {
+    iterator it;
+    if (!root_m) {
+      return it;
+    }
+    std::size_t hash = hash_m(key);
+    const Node* node = root_m.get();
+    for (int shift = 0; ; shift += BITS) {
+      it.node_m[it.depth_m++] = node;
+      if (node->collision) {
+	for (std::size_t i = 0; i < node->slots.size(); ++i) {
+	  if (node->slots[i].entry.first == key) {
+	    it.index_m[it.depth_m - 1] = i;
+	    return it;
+	  }
+	}
+	return iterator();
+      }
+      unsigned int bit = 1U << ((hash >> shift) & MASK);
+      if (!(node->bitmap & bit)) {
+	return iterator();
+      }
+      int pos = position(node->bitmap, bit);
+      it.index_m[it.depth_m - 1] = pos;
+      const Slot& slot = node->slots[pos];
+      if (slot.child) {
+	node = slot.child.get();
+      } else if (slot.hash == hash && slot.entry.first == key) {
+	return it;
+      } else {
+	return iterator();
+      }
+    }
+  }
+
+  /**
+   * \brief Add entry, unless its key is already in the map.
+   * \return The iterator of the entry of the key, and whether it was added.
+   */
+  std::pair<iterator, bool> insert(const value_type& entry)
+  {
+    bool added = update(make_slot(entry), false);
+    return std::make_pair(find(entry.first), added);
+  }
+
+  /**
+   * \brief Bind key to value, replacing any previous binding.
+   * \return Void.
+   */
+  void assign(const Key& key, const T& value)
+  {
+    update(make_slot(value_type(key, value)), true);
+  }
+
+  /**
+   * \brief Get an iterator at the first entry.
+   * \return An iterator of the map.
+   */
+  iterator begin() const
+  {
+    iterator it;
+    if (root_m && !root_m->slots.empty()) {
+      it.node_m[0] = root_m.get();
+      it.index_m[0] = 0;
+      it.depth_m = 1;
+      it.settle();
+    }
+    return it;
+  }
+
+  /**
+   * \brief Get the iterator past the last entry.
+   * \return An iterator of the map.
+   */
+  iterator end() const
+  {
+    return iterator();
+  }
+
+  /**
+   * \brief Get the number of entries.
+   * \return The size.
+   */
+  size_type size() const
+  {
+    return size_m;
+  }
+
+  /**
+   * \brief Check whether there is no entry.
+   * \return True if the map is empty.
+   */
+  bool empty() const
+  {
+    return size_m == 0;
+  }
+
+  /**
+   * \brief Remove every entry; the nodes stay in any other copy.
+   * \return Void.
+   */
+  void clear()
+  {
+    root_m.reset();
+    size_m = 0;
+  }
+
+private:
+  NodePtr root_m;
+  size_type size_m;
+  Hash hash_m;
+};
+
+#endif // HAMTMAP_HPP
@@ -62,12 +62,13 @@ public:
 
 private:
   /**
-   * \brief Template function for hashing user-defined key type.
+   * \brief Template function for hashing user-defined key type. The key
+   * type is expected to provide its own hash() member.
    * \return The hash value.
    */
   template <typename convert_T>
-  index_type _hash(convert_T key) const {
-    return 0;
+  index_type _hash(const convert_T& key) const {
+    return key.hash() % size_m;
   }
 
   /**
@@ -88,7 +89,7 @@ private:
    */
   void _deep_copy(const Self& x) {
     for (int i = 0; i < x.size_m; ++i) {
-      bucket_list_m[i] = x.bucket_list_m[i];
+      bucket_list_m[i] = x.bucket_list_m[i] == NULL ? NULL : new _value_list(*x.bucket_list_m[i]);
     }
   }
   
@@ -196,8 +197,11 @@ public:
     base_iterator& operator++ () {
       if (map_m != NULL && ++value_it_m != map_m->bucket_list_m[bucket_index_m]->end()) {
       } else {
-	while (map_m->bucket_list_m[++bucket_index_m] == NULL);
-	if (bucket_index_m <= map_m->size_m) {
+	// skip unused buckets without running past the last one
+	while (++bucket_index_m < (long) map_m->size_m
+	       && (map_m->bucket_list_m[bucket_index_m] == NULL
+		   || map_m->bucket_list_m[bucket_index_m]->empty()));
+	if (bucket_index_m < (long) map_m->size_m) {
 	  value_it_m = map_m->bucket_list_m[bucket_index_m]->begin();
 	} else {
 	  map_m = NULL;
@@ -231,6 +235,12 @@ public:
    */
   hashtablemap() : bucket_list_m(_bucket_list(DEFAULT_SIZE)), size_m(DEFAULT_SIZE) {}
 
+  /**
+   * \brief Constructor with a given number of buckets, for maps expected to
+   * grow far beyond DEFAULT_SIZE entries.
+   */
+  explicit hashtablemap(size_type n) : bucket_list_m(_bucket_list(n)), size_m(n) {}
+
   /**
    * \brief Copy constructor for deep copying.
    */
@@ -250,7 +260,12 @@ public:
    * \return The copying object.
    */
   Self& operator= (const Self& x) {
-    _deep_copy(x);
+    if (this != &x) {
+      clear();
+      bucket_list_m.resize(x.size_m);
+      size_m = x.size_m;
+      _deep_copy(x);
+    }
     return *this;
   }
 
@@ -260,7 +275,7 @@ public:
    */
   iterator begin() {
     for (int i = 0; i < size_m; ++i) {
-      if (bucket_list_m[i] != NULL) {
+      if (bucket_list_m[i] != NULL && !bucket_list_m[i]->empty()) {
 	return iterator(this, i, bucket_list_m[i]->begin());
       }
     }
@@ -273,7 +288,7 @@ public:
    */
   const_iterator begin() const {
     for (int i = 0; i < size_m; ++i) {
-      if (bucket_list_m[i] != NULL) {
+      if (bucket_list_m[i] != NULL && !bucket_list_m[i]->empty()) {
 	return const_iterator(this, i, bucket_list_m[i]->begin());
       }
     }
@@ -378,11 +393,9 @@ public:
    */
   void clear() {
     for (_bucket_iterator bit = bucket_list_m.begin(); bit != bucket_list_m.end(); ++bit) {
-      if (*bit != NULL) {
-	(*bit)->clear();
-      }
+      delete *bit;
+      *bit = NULL;
     }
-    bucket_list_m.clear();
   }
 
   /**
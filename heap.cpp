@@ -0,0 +1,87 @@
+/**
+ * \file heap.cpp
+ *
+ * Implementation of the allocation statistics of cells.
+ */
+
+#include "heap.hpp"
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+thread_local HeapCounters* heap_counters = NULL;
+
+/**
+ * \brief Names of the types, in HeapType order.
+ */
+const char* const HEAP_TYPE_NAMES[HEAP_TYPES] = {
+  "int", "double", "symbol", "cons", "procedure", "future"
+};
+
+mutex all_heap_counters_mutex;
+vector<HeapCounters*> all_heap_counters; // never freed, the counts outlive their threads
+
+HeapCounters* register_heap_counters()
+{
+  HeapCounters* h = new HeapCounters();
+  for (int t = 0; t < HEAP_TYPES; ++t) {
+    h->made[t] = 0;
+    h->deleted[t] = 0;
+    h->bytes_made[t] = 0;
+    h->bytes_deleted[t] = 0;
+    h->high_water[t] = 0;
+  }
+  lock_guard<mutex> lock(all_heap_counters_mutex);
+  all_heap_counters.push_back(h);
+  heap_counters = h;
+  return h;
+}
+
+void heap_stats(HeapStats stats[HEAP_TYPES])
+{
+  for (int t = 0; t < HEAP_TYPES; ++t) {
+    HeapStats s = {HEAP_TYPE_NAMES[t], 0, 0, 0, 0, 0};
+    stats[t] = s;
+  }
+  lock_guard<mutex> lock(all_heap_counters_mutex);
+  for (vector<HeapCounters*>::size_type i = 0; i < all_heap_counters.size(); ++i) {
+    HeapCounters* h = all_heap_counters[i];
+    for (int t = 0; t < HEAP_TYPES; ++t) {
+      long made = h->made[t].load(memory_order_relaxed);
+      long bytes_made = h->bytes_made[t].load(memory_order_relaxed);
+      stats[t].made += made;
+      stats[t].live += made - h->deleted[t].load(memory_order_relaxed);
+      stats[t].bytes_made += bytes_made;
+      stats[t].live_bytes += bytes_made - h->bytes_deleted[t].load(memory_order_relaxed);
+      long high = h->high_water[t].load(memory_order_relaxed);
+      if (high > stats[t].high_water) {
+	stats[t].high_water = high;
+      }
+    }
+  }
+}
+
+void write_heap_stats(ostream& os)
+{
+  HeapStats stats[HEAP_TYPES];
+  heap_stats(stats);
+  HeapStats total = {"total", 0, 0, 0, 0, 0};
+  os << left << setw(12) << "type" << right
+     << setw(12) << "live" << setw(12) << "made"
+     << setw(14) << "live bytes" << setw(14) << "bytes made"
+     << setw(12) << "high water" << endl;
+  for (int t = 0; t <= HEAP_TYPES; ++t) {
+    const HeapStats& s = t < HEAP_TYPES ? stats[t] : total;
+    os << left << setw(12) << s.type << right
+       << setw(12) << s.live << setw(12) << s.made
+       << setw(14) << s.live_bytes << setw(14) << s.bytes_made
+       << setw(12) << s.high_water << endl;
+    if (t < HEAP_TYPES) {
+      total.live += s.live;
+      total.made += s.made;
+      total.live_bytes += s.live_bytes;
+      total.bytes_made += s.bytes_made;
+      total.high_water += s.high_water;
+    }
+  }
+}
@@ -0,0 +1,115 @@
+/**
+ * \file heap.hpp
+ *
+ * Encapsulates the allocation statistics of cells. The factories in
+ * cons.hpp report every cell they make and every cell deleted through
+ * them, per type, to counters of the calling thread, which a report adds
+ * up over all threads.
+ */
+
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+
+/**
+ * \brief The types of cell counted apart.
+ */
+typedef enum e_heap_type {
+  HEAP_INT, HEAP_DOUBLE, HEAP_SYMBOL, HEAP_CONS, HEAP_PROCEDURE, HEAP_FUTURE,
+  HEAP_TYPES
+} HeapType;
+
+/**
+ * \struct HeapCounters
+ * \brief The cells made and deleted by one thread. Only their own thread
+ * writes them, so relaxed loads and stores suffice.
+ */
+struct HeapCounters {
+  atomic<long> made[HEAP_TYPES];
+  atomic<long> deleted[HEAP_TYPES];
+  atomic<long> bytes_made[HEAP_TYPES];
+  atomic<long> bytes_deleted[HEAP_TYPES];
+  atomic<long> high_water[HEAP_TYPES];
+};
+
+/**
+ * \brief The counters of the calling thread, NULL until it makes a cell.
+ */
+extern thread_local HeapCounters* heap_counters;
+
+/**
+ * \brief Create and register the counters of the calling thread.
+ * \return The counters.
+ */
+HeapCounters* register_heap_counters();
+
+/**
+ * \brief Add to a counter of the calling thread.
+ * \return The new value.
+ */
+inline long heap_add(atomic<long>& counter, long n)
+{
+  long value = counter.load(memory_order_relaxed) + n;
+  counter.store(value, memory_order_relaxed);
+  return value;
+}
+
+/**
+ * \brief Count a cell of the given type and size made by the calling
+ * thread.
+ * \return Void.
+ */
+inline void count_made(HeapType type, size_t bytes)
+{
+  HeapCounters* h = heap_counters != NULL ? heap_counters : register_heap_counters();
+  long live = heap_add(h->made[type], 1) - h->deleted[type].load(memory_order_relaxed);
+  heap_add(h->bytes_made[type], bytes);
+  if (live > h->high_water[type].load(memory_order_relaxed)) {
+    h->high_water[type].store(live, memory_order_relaxed);
+  }
+}
+
+/**
+ * \brief Count a cell of the given type and size deleted by the calling
+ * thread.
+ * \return Void.
+ */
+inline void count_deleted(HeapType type, size_t bytes)
+{
+  HeapCounters* h = heap_counters != NULL ? heap_counters : register_heap_counters();
+  heap_add(h->deleted[type], 1);
+  heap_add(h->bytes_deleted[type], bytes);
+}
+
+/**
+ * \struct HeapStats
+ * \brief The totals of one type of cell over all threads.
+ */
+struct HeapStats {
+  const char* type;
+  long live;
+  long made;
+  long live_bytes;
+  long bytes_made;
+  long high_water; // most cells of the type live on any one thread at once
+};
+
+/**
+ * \brief Add up the counters of all threads.
+ * \param stats Filled with one entry per type, in HeapType order.
+ * \return Void.
+ */
+void heap_stats(HeapStats stats[HEAP_TYPES]);
+
+/**
+ * \brief Write the totals of every type as a table.
+ * \return Void.
+ */
+void write_heap_stats(ostream& os);
+
+#endif // HEAP_HPP
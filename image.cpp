@@ -0,0 +1,290 @@
+/**
+ * \file image.cpp
+ *
+ * Implementation of the heap image format. An image consists of
+ *   - the 8 byte magic "MLIMG001",
+ *   - a symbol table: a count followed by length-prefixed names,
+ *   - the cell table: a count followed by one tagged record per cell,
+ *     children always preceding their parents,
+ *   - the bindings: a count followed by (name, cell) pairs.
+ * Cells refer to each other by 1-based position in the cell table, with 0
+ * standing for nil, so shared structure is written and restored once.
+ */
+
+#include "image.hpp"
+#include "eval.hpp"
+#include "BinaryIO.hpp"
+#include "MemoCache.hpp"
+#include <cstdio>
+#include <map>
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+const char IMAGE_MAGIC[] = "MLIMG001";
+const int IMAGE_MAGIC_SIZE = 8;
+
+/**
+ * \brief Record tags of the cell table.
+ */
+typedef enum e_image_tag {
+  TAG_INT = 1,
+  TAG_DOUBLE,
+  TAG_SYMBOL,
+  TAG_CONS,
+  TAG_PROCEDURE,
+  TAG_MEMO
+} ImageTag;
+
+/**
+ * \class ImageWriter
+ * \brief Numbers the cells reachable from the global scope and the symbol
+ * names they use.
+ */
+class ImageWriter {
+  
+public:
+
+  /**
+   * \brief Number root and every cell reachable from it that has not been
+   * numbered yet, children first. Iterative so that long lists do not
+   * exhaust the native stack.
+   * \return Void.
+   */
+  void add(Cell* const root)
+  {
+    vector<pair<Cell*, bool> > pending;
+    pending.push_back(make_pair(root, false));
+    while (!pending.empty()) {
+      Cell* c = pending.back().first;
+      bool expanded = pending.back().second;
+      pending.pop_back();
+      if (nullp(c) || index_m.count(c)) {
+	continue;
+      }
+      if (expanded) {
+	cells_m.push_back(c);
+	index_m[c] = cells_m.size();
+	if (symbolp(c)) {
+	  symbol(get_symbol(c));
+	}
+	continue;
+      }
+      pending.push_back(make_pair(c, true));
+      if (listp(c)) {
+	pending.push_back(make_pair(cdr(c), false));
+	pending.push_back(make_pair(car(c), false));
+      } else if (procedurep(c)) {
+	pending.push_back(make_pair(get_body(c), false));
+	pending.push_back(make_pair(get_formals(c), false));
+      }
+    }
+  }
+
+  /**
+   * \brief Number a symbol name if it has not been numbered yet.
+   * \return Position of the name in the symbol table.
+   */
+  unsigned long symbol(const string& s)
+  {
+    map<string, unsigned long>::iterator it = symbol_index_m.find(s);
+    if (it != symbol_index_m.end()) {
+      return it->second;
+    }
+    symbol_index_m[s] = symbols_m.size();
+    symbols_m.push_back(s);
+    return symbols_m.size() - 1;
+  }
+
+  /**
+   * \brief Accessor.
+   * \return Reference to c in the cell table, 0 for nil.
+   */
+  unsigned long ref(Cell* const c)
+  {
+    return nullp(c) ? 0 : index_m[c];
+  }
+
+  /**
+   * \brief Encode the symbol table and the cell table.
+   * \return Void.
+   */
+  void write_tables(BinaryWriter& out)
+  {
+    out.put_varint(symbols_m.size());
+    for (vector<string>::size_type i = 0; i < symbols_m.size(); ++i) {
+      out.put_string(symbols_m[i]);
+    }
+    out.put_varint(cells_m.size());
+    for (vector<Cell*>::size_type i = 0; i < cells_m.size(); ++i) {
+      Cell* c = cells_m[i];
+      if (intp(c)) {
+	out.put_byte(TAG_INT);
+	out.put_svarint(get_int(c));
+      } else if (doublep(c)) {
+	out.put_byte(TAG_DOUBLE);
+	out.put_double(get_double(c));
+      } else if (symbolp(c)) {
+	out.put_byte(TAG_SYMBOL);
+	out.put_varint(symbol_index_m[get_symbol(c)]);
+      } else if (listp(c)) {
+	out.put_byte(TAG_CONS);
+	out.put_varint(ref(car(c)));
+	out.put_varint(ref(cdr(c)));
+      } else if (memoizedp(c)) {
+	out.put_byte(TAG_MEMO);
+	out.put_varint(ref(get_formals(c)));
+	out.put_varint(ref(get_body(c)));
+	out.put_varint(get_memo(c)->capacity());
+      } else if (procedurep(c)) {
+	out.put_byte(TAG_PROCEDURE);
+	out.put_varint(ref(get_formals(c)));
+	out.put_varint(ref(get_body(c)));
+      } else {
+	throw runtime_error("cannot save a cell of unknown type to an image");
+      }
+    }
+  }
+
+private:
+  map<Cell*, unsigned long> index_m;
+  vector<Cell*> cells_m;
+  map<string, unsigned long> symbol_index_m;
+  vector<string> symbols_m;
+  
+};
+
+/**
+ * \brief Resolve a cell reference read from an image.
+ * \return The cell, nil for reference 0 (error if out of range).
+ */
+Cell* image_ref(const vector<Cell*>& cells, unsigned long ref) throw (runtime_error)
+{
+  if (ref > cells.size()) {
+    throw runtime_error("corrupt image: dangling cell reference");
+  }
+  return ref == 0 ? nil : cells[ref - 1];
+}
+
+/**
+ * \brief Read the element count of a table from an image. Every element
+ * takes at least one byte, so larger counts can only come from a corrupt
+ * file.
+ * \return The count (error if it exceeds the bytes left).
+ */
+unsigned long image_count(BinaryReader& in) throw (runtime_error)
+{
+  unsigned long n = in.get_varint();
+  if (n > in.remaining()) {
+    throw runtime_error("corrupt image: table larger than the file");
+  }
+  return n;
+}
+
+void save_image(Interpreter& interp, const char* path) throw (runtime_error)
+{
+  RefDict& env = interp.global_env();
+  ImageWriter writer;
+  vector<pair<string, Cell*> > bindings;
+  for (RefDict::RefIter it = env.begin(); it != env.end(); ++it) {
+    if (nativep(it->second)) {
+      continue; // the embedding program defines them again
+    }
+    bindings.push_back(make_pair(it->first, it->second));
+    writer.add(it->second);
+  }
+  for (vector<pair<string, Cell*> >::size_type i = 0; i < bindings.size(); ++i) {
+    writer.symbol(bindings[i].first);
+  }
+  
+  BinaryWriter out;
+  for (int i = 0; i < IMAGE_MAGIC_SIZE; ++i) {
+    out.put_byte(IMAGE_MAGIC[i]);
+  }
+  writer.write_tables(out);
+  out.put_varint(bindings.size());
+  for (vector<pair<string, Cell*> >::size_type i = 0; i < bindings.size(); ++i) {
+    out.put_varint(writer.symbol(bindings[i].first));
+    out.put_varint(writer.ref(bindings[i].second));
+  }
+  
+  FILE* fp = fopen(path, "wb");
+  if (fp == NULL) {
+    throw runtime_error(string("cannot write image ") + path);
+  }
+  size_t written = fwrite(out.buffer().data(), 1, out.buffer().size(), fp);
+  if (fclose(fp) != 0 || written != out.buffer().size()) {
+    throw runtime_error(string("cannot write image ") + path);
+  }
+}
+
+void load_image(Interpreter& interp, const char* path) throw (runtime_error)
+{
+  MappedFile file(path);
+  BinaryReader in(file.begin(), file.end());
+  if (memcmp(in.get_bytes(IMAGE_MAGIC_SIZE), IMAGE_MAGIC, IMAGE_MAGIC_SIZE) != 0) {
+    throw runtime_error(string(path) + " is not a heap image");
+  }
+  
+  vector<string> symbols(image_count(in));
+  for (vector<string>::size_type i = 0; i < symbols.size(); ++i) {
+    symbols[i] = in.get_string();
+  }
+  
+  // relocate: every reference is replaced by the address of the new cell
+  vector<Cell*> cells;
+  unsigned long num_cells = image_count(in);
+  cells.reserve(num_cells);
+  for (unsigned long i = 0; i < num_cells; ++i) {
+    unsigned long first, second, symbol;
+    switch (in.get_byte()) {
+    case TAG_INT:
+      cells.push_back(make_int((int) in.get_svarint()));
+      break;
+    case TAG_DOUBLE:
+      cells.push_back(make_double(in.get_double()));
+      break;
+    case TAG_SYMBOL:
+      symbol = in.get_varint();
+      if (symbol >= symbols.size()) {
+	throw runtime_error("corrupt image: dangling symbol reference");
+      }
+      cells.push_back(make_symbol(symbols[symbol].c_str()));
+      break;
+    case TAG_CONS:
+      first = in.get_varint();
+      second = in.get_varint();
+      cells.push_back(cons(image_ref(cells, first), image_ref(cells, second)));
+      break;
+    case TAG_PROCEDURE:
+      first = in.get_varint();
+      second = in.get_varint();
+      cells.push_back(lambda(image_ref(cells, first), image_ref(cells, second)));
+      break;
+    case TAG_MEMO:
+      first = in.get_varint();
+      second = in.get_varint();
+      cells.push_back(memoize(image_ref(cells, first), image_ref(cells, second),
+			      (int) in.get_varint()));
+      break;
+    default:
+      throw runtime_error("corrupt image: unknown cell tag");
+    }
+  }
+  
+  RefDict& env = interp.global_env();
+  for (unsigned long i = 0, n = image_count(in); i < n; ++i) {
+    unsigned long name = in.get_varint();
+    Cell* value = image_ref(cells, in.get_varint());
+    if (name >= symbols.size()) {
+      throw runtime_error("corrupt image: dangling symbol reference");
+    }
+    if (env.lookup(symbols[name]) == env.end()) {
+      env.insert(symbols[name], value);
+      if (procedurep(value)) {
+	value->set_name(make_symbol(symbols[name].c_str()));
+      }
+    }
+  }
+}
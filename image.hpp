@@ -0,0 +1,31 @@
+/**
+ * \file image.hpp
+ *
+ * Encapsulates the interface for saving the global scope to a binary heap
+ * image and restoring it at startup, so that a library such as
+ * library.scm need not be parsed and evaluated by every process.
+ */
+
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include "cons.hpp"
+#include "Interpreter.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * \brief Write every global definition of interp, together with all cells reachable
+ * from it, to the image file at path (error if the file cannot be written).
+ */
+void save_image(Interpreter& interp, const char* path) throw (runtime_error);
+
+/**
+ * \brief Map the image file at path and rebuild its cells and global
+ * definitions into interp. Names that are already defined are left untouched (error
+ * if the file is not a valid image).
+ */
+void load_image(Interpreter& interp, const char* path) throw (runtime_error);
+
+#endif // IMAGE_HPP
@@ -54,11 +54,7 @@
   (lambda args (car args)))
 
 (define list
-  (lambda args
-    (if (nullp args)
-	args
-	(cons (car args)
-	      (list (cdr args))))))
+  (lambda args args))
 	      
 (define for-each
   (lambda (f l)
@@ -169,14 +165,28 @@
 	    (append (cons t (quote ())) (quote (())))
 	    (append (cons t (quote ())) (cons f (quote ())))))))
 
+(define list-sort-below
+  (lambda (less pivot l)
+    (if (nullp l)
+	l
+	(if (less (car l) pivot)
+	    (cons (car l) (list-sort-below less pivot (cdr l)))
+	    (list-sort-below less pivot (cdr l))))))
+
+(define list-sort-above
+  (lambda (less pivot l)
+    (if (nullp l)
+	l
+	(if (less (car l) pivot)
+	    (list-sort-above less pivot (cdr l))
+	    (cons (car l) (list-sort-above less pivot (cdr l)))))))
+
 (define list-sort
-  (lambda (p l)
-    (define partition-by-pivot
-      (lambda (l)
-	(list-partition (p (list-ref l (/ (list-size l) 2)) l) l)))
-    (if (listp l)
-	(if (< (list-size l) 2)
+  (lambda (less l)
+    (if (nullp l)
+	l
+	(if (nullp (cdr l))
 	    l
-	    (append (list-sort p (car (partition-by-pivot l)))
-		    (append (cons pivot (quote()))
-			    (list-sort p (car (cdr (partition-by-pivot l))))))))))
+	    (append (list-sort less (list-sort-below less (car l) (cdr l)))
+		    (cons (car l)
+			  (list-sort less (list-sort-above less (car l) (cdr l)))))))))
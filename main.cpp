@@ -10,34 +10,75 @@
 #include <stdexcept>
 #include "parse.hpp"
 #include "eval.hpp"
+#include "image.hpp"
+#include "binary.hpp"
+#include "ThreadPool.hpp"
+#include "profile.hpp"
+#include "heap.hpp"
+#include "serve.hpp"
 #include <sstream>
+#include <cstdlib>
+#include <pthread.h>
 
 using namespace std;
 
 /**
- * \brief Parse and evaluate the s-expression, and print the result.
- * \param sexpr The string vaule holding the s-expression.
+ * \brief Samples taken per second of CPU time by --profile.
+ */
+const int PROFILE_HZ = 997;
+
+/**
+ * \brief Size of the stack the driver runs on, so that the depth of
+ * recursion is bounded by --max-depth rather than by the default stack.
+ * Pages are only committed as deep recursion reaches them.
+ */
+const size_t MAIN_STACK_SIZE = (size_t) 1 << 30;
+
+/**
+ * \brief The command line, passed to the thread running the driver.
+ */
+struct Arguments {
+  int argc;
+  char** argv;
+  int status;
+};
+
+/**
+ * \brief Evaluate the expression tree, and print the result.
+ * \param interp The interpreter to evaluate in.
+ * \param root The root of the expression tree.
  */
-void parse_eval_print(string sexpr)
+void eval_print(Interpreter& interp, Cell* root)
 {
+  Interpreter::Snapshot before;
+  if (interp.transactional()) {
+    before = interp.snapshot();
+  }
   try {
-    Cell* root = parse(sexpr);
-    Cell* result = eval(root);
-    if ( result == nil ) {
-      cout << "()" << endl;
-    } else {
-      cout << *result << endl;
-    }
+    interp.out_buffer().print_line(eval(interp, root));
     // delete root;
     // delete result;
   } catch (runtime_error &e) {
-    cerr << "ERROR: " << e.what() << endl;
+    if (interp.transactional()) {
+      interp.rollback(before);
+    }
+    interp.err() << "ERROR: " << e.what() << endl;
   } catch (logic_error &e) {
-    cerr << "LOGIC ERROR: " << e.what() << endl;
+    interp.err() << "LOGIC ERROR: " << e.what() << endl;
     exit(1);
   }
 }
 
+/**
+ * \brief Parse and evaluate the s-expression, and print the result.
+ * \param interp The interpreter to evaluate in.
+ * \param sexpr The string vaule holding the s-expression.
+ */
+void parse_eval_print(Interpreter& interp, string sexpr)
+{
+  eval_print(interp, parse(interp, sexpr));
+}
+
 /**
  * \brief Read single single symbol into the end of a string buffer.
  * \param fin The input file stream.
@@ -72,9 +113,10 @@ void readsinglesymbol(ifstream& fin, string& str)
  * \brief Read, parse, evaluate, and print the expression one by one from
  * the input stream.
  *
+ * \param interp The interpreter to evaluate in.
  * \param fin The input file stream.
  */
-void readfile(ifstream& fin)
+void readfile(Interpreter& interp, ifstream& fin)
 {
   string sexp;
   bool isstartsexp = false;
@@ -101,7 +143,7 @@ void readfile(ifstream& fin)
 	fin.putback(currentchar);
 	readsinglesymbol(fin, sexp);
 	// call function
-	parse_eval_print(sexp);
+	parse_eval_print(interp, sexp);
 	sexp.clear();
       }	else {
 	// start new expression
@@ -131,7 +173,7 @@ void readfile(ifstream& fin)
 	      // current s-expression ends
 	      isstartsexp  =  false;
 	      // call functions
-	      parse_eval_print(sexp);
+	      parse_eval_print(interp, sexp);
 	      sexp.clear();
 	    }
 	  }
@@ -143,25 +185,86 @@ void readfile(ifstream& fin)
 
 /**
  * \brief Read the expressions from the file.
+ * \param interp The interpreter to evaluate in.
  * \param fn The file name.
  */
-void readfile(char* fn)
+void readfile(Interpreter& interp, char* fn)
 {
   ifstream fin(fn);
-  readfile(fin);
+  readfile(interp, fin);
   fin.close();
 }
 
+/**
+ * \brief Evaluate and print the trees stored in a binary s-expression file
+ * one by one, decoding each only when it is reached.
+ * \param interp The interpreter to evaluate in.
+ * \param fn The file name.
+ */
+void readbinaryfile(Interpreter& interp, char* fn)
+{
+  try {
+    MappedFile file(fn);
+    BinaryLoader loader(file.begin(), file.end());
+    Cell* root;
+    while (loader.next(root)) {
+      eval_print(interp, root);
+    }
+  } catch (runtime_error &e) {
+    interp.err() << "ERROR: " << e.what() << endl;
+  }
+}
+
+/**
+ * \brief Evaluate every file on its own copy of the global definitions of
+ * proto, spreading the files over a pool of worker threads. The output of
+ * each file is collected separately and printed in the order the files
+ * were given, followed by its errors.
+ * \param proto The interpreter holding the shared definitions.
+ * \param jobs The number of threads.
+ * \param files The file names.
+ * \param n The number of files.
+ * \param binary Whether the files hold binary s-expressions.
+ */
+void readfiles(Interpreter& proto, int jobs, char** files, int n, bool binary)
+{
+  vector<string> outs(n);
+  vector<string> errs(n);
+  vector<ThreadPool::Task> tasks;
+  for (int i = 0; i < n; ++i) {
+    tasks.push_back([&proto, &outs, &errs, files, binary, i] {
+	ostringstream out;
+	ostringstream err;
+	Interpreter interp(proto, out, err);
+	if (binary) {
+	  readbinaryfile(interp, files[i]);
+	} else {
+	  readfile(interp, files[i]);
+	}
+	interp.out_buffer().flush();
+	outs[i] = out.str();
+	errs[i] = err.str();
+      });
+  }
+  ThreadPool pool(jobs);
+  pool.run(tasks);
+  for (int i = 0; i < n; ++i) {
+    cout << outs[i] << flush;
+    cerr << errs[i] << flush;
+  }
+}
+
 /**
  * \brief Read, parse, evaluate, and print the expression one by one from
  * the standard input, interactively.
+ * \param interp The interpreter to evaluate in.
  */
-void readconsole()
+void readconsole(Interpreter& interp)
 {
   string sexpr;
   // read the input
   do {
-    cout << "> ";
+    interp.out() << "> " << flush;
     getline(cin, sexpr);
     if (cin.eof()) {
       break;
@@ -169,28 +272,209 @@ void readconsole()
     if ("(exit)" == sexpr) {
       return;
     }
-    parse_eval_print(sexpr);
+    parse_eval_print(interp, sexpr);
   } while (true);
 }
 
 /**
- * \brief Call either the batch or interactive main drivers.
+ * \brief Call either the batch or interactive main drivers. Options given
+ * before the file name:
+ *   --hashcons          share structurally equal cells built by the parser
+ *   --transactional     undo the definitions of a top-level expression
+ *                       that fails
+ *   --image FILE        restore the global definitions saved in FILE first
+ *   --save-image FILE   save the global definitions to FILE at the end
+ *   --binary            the file holds binary s-expressions, not text
+ *   --library FILE      evaluate FILE first, before any other file
+ *   --jobs N            evaluate any number of files on N threads, each
+ *                       starting from the definitions made so far
+ *   --profile FILE      sample the procedures being applied and write
+ *                       them to FILE as folded stacks for flamegraph.pl
+ *   --call-stats FORMAT count and time every call, and print the totals
+ *                       per procedure to the standard error at the end,
+ *                       as a table or as json
+ *   --heap-stats        print the cells made and live per type to the
+ *                       standard error at the end
+ *   --max-depth N       fail an expression nesting calls deeper than N
+ *                       (100000 by default) with an error
+ *   --max-steps N       fail an expression taking more than N procedure
+ *                       calls and loop iterations
+ *   --max-memory BYTES  fail an expression making more than BYTES of cells
+ *   --time-limit MS     fail an expression running longer than MS
+ *                       milliseconds
+ *   --serve PATH        instead of reading input, answer the requests of
+ *                       clients of a Unix domain socket at PATH, each on
+ *                       its own copy of the definitions made so far,
+ *                       with a time limit of 10 seconds unless one is
+ *                       given
+ * \return The exit status.
  */
-int main(int argc, char* argv[])
+int run(int argc, char* argv[])
 {
-  switch(argc) {
-  case 1:
-    // read from the standard input
-    readconsole();
-    exit(0);
-    break;
-  case 2:
-    // read from a file
-    readfile(argv[1]);
-    break;
-  default:
-    cout << "too many arguments!" << endl;
-    exit(0);
+  Interpreter interp;
+  char* save_path = NULL;
+  char* profile_path = NULL;
+  char* serve_path = NULL;
+  string call_stats;
+  bool print_heap_stats = false;
+  bool binary = false;
+  int jobs = 0;
+  int argi = 1;
+  try {
+    while (argi < argc && string(argv[argi]).compare(0, 2, "--") == 0) {
+      string option = argv[argi++];
+      if (option == "--hashcons") {
+	interp.set_hashcons(true);
+      } else if (option == "--transactional") {
+	interp.set_transactional(true);
+      } else if (option == "--image" && argi < argc) {
+	load_image(interp, argv[argi++]);
+      } else if (option == "--save-image" && argi < argc) {
+	save_path = argv[argi++];
+      } else if (option == "--binary") {
+	binary = true;
+      } else if (option == "--library" && argi < argc) {
+	readfile(interp, argv[argi++]);
+      } else if (option == "--profile" && argi < argc) {
+	profile_path = argv[argi++];
+	start_sampling(PROFILE_HZ);
+      } else if (option == "--call-stats" && argi < argc) {
+	call_stats = argv[argi++];
+	if (call_stats != "table" && call_stats != "json") {
+	  throw runtime_error("--call-stats expects table or json");
+	}
+	start_counting();
+      } else if (option == "--heap-stats") {
+	print_heap_stats = true;
+      } else if (option == "--jobs" && argi < argc) {
+	jobs = atoi(argv[argi++]);
+	if (jobs < 1) {
+	  throw runtime_error("--jobs expects a positive number of threads");
+	}
+      } else if (option == "--max-depth" && argi < argc) {
+	int max_depth = atoi(argv[argi++]);
+	if (max_depth < 1) {
+	  throw runtime_error("--max-depth expects a positive depth");
+	}
+	interp.set_max_depth(max_depth);
+      } else if (option == "--serve" && argi < argc) {
+	serve_path = argv[argi++];
+      } else if (option == "--max-steps" && argi < argc) {
+	interp.limits().max_steps = atol(argv[argi++]);
+	if (interp.limits().max_steps < 1) {
+	  throw runtime_error("--max-steps expects a positive number of steps");
+	}
+      } else if (option == "--max-memory" && argi < argc) {
+	interp.limits().max_bytes = atol(argv[argi++]);
+	if (interp.limits().max_bytes < 1) {
+	  throw runtime_error("--max-memory expects a positive number of bytes");
+	}
+      } else if (option == "--time-limit" && argi < argc) {
+	interp.limits().max_millis = atol(argv[argi++]);
+	if (interp.limits().max_millis < 1) {
+	  throw runtime_error("--time-limit expects a positive number of milliseconds");
+	}
+      } else {
+	cout << "unknown option " << option << endl;
+	exit(0);
+      }
+    }
+  } catch (runtime_error &e) {
+    interp.err() << "ERROR: " << e.what() << endl;
+    exit(1);
+  }
+  
+  if (serve_path != NULL) {
+    interp.out_buffer().flush();
+    if (interp.limits().max_millis == 0) {
+      interp.limits().max_millis = SERVE_TIME_LIMIT_MS;
+    }
+    try {
+      serve(interp, serve_path);
+    } catch (runtime_error &e) {
+      interp.err() << "ERROR: " << e.what() << endl;
+      exit(1);
+    }
+  } else if (jobs > 0) {
+    // read any number of files concurrently
+    readfiles(interp, jobs, argv + argi, argc - argi, binary);
+  } else {
+    switch(argc - argi) {
+    case 0:
+      // read from the standard input
+      readconsole(interp);
+      break;
+    case 1:
+      // read from a file
+      if (binary) {
+	readbinaryfile(interp, argv[argi]);
+      } else {
+	readfile(interp, argv[argi]);
+      }
+      break;
+    default:
+      cout << "too many arguments!" << endl;
+      exit(0);
+    }
+  }
+  // the end of the batch
+  interp.out_buffer().flush();
+  
+  if (profile_path != NULL) {
+    try {
+      stop_sampling(profile_path);
+    } catch (runtime_error &e) {
+      interp.err() << "ERROR: " << e.what() << endl;
+      exit(1);
+    }
+  }
+  
+  if (!call_stats.empty()) {
+    write_call_stats(cerr, call_stats == "json");
+  }
+  
+  if (print_heap_stats) {
+    write_heap_stats(cerr);
+  }
+  
+  if (save_path != NULL) {
+    try {
+      save_image(interp, save_path);
+    } catch (runtime_error &e) {
+      interp.err() << "ERROR: " << e.what() << endl;
+      exit(1);
+    }
   }
   return 0;
 }
+
+/**
+ * \brief Run the driver on the large-stack thread.
+ * \return NULL always.
+ */
+void* run_thread(void* p)
+{
+  Arguments* args = (Arguments*) p;
+  args->status = run(args->argc, args->argv);
+  return NULL;
+}
+
+/**
+ * \brief Run the driver on a thread with a stack of MAIN_STACK_SIZE, or on
+ * this one if no such thread can be made.
+ */
+int main(int argc, char* argv[])
+{
+  Arguments args = { argc, argv, 0 };
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, MAIN_STACK_SIZE);
+  pthread_t runner;
+  if (pthread_create(&runner, &attr, run_thread, &args) == 0) {
+    pthread_join(runner, NULL);
+  } else {
+    args.status = run(argc, argv);
+  }
+  pthread_attr_destroy(&attr);
+  return args.status;
+}
@@ -0,0 +1,53 @@
+/**
+ * \file microlisp.cpp
+ *
+ * Implementation of the interface for embedding the interpreter.
+ */
+
+#include "microlisp.hpp"
+#include "RefDict.hpp"
+
+Cell* eval_buffer(Interpreter& interp, const char* buffer, size_t length) throw (runtime_error)
+{
+  const char* pos = buffer;
+  const char* end = buffer + length;
+  Cell* root;
+  Cell* result = nil;
+  while (parse_next(interp, pos, end, root)) {
+    result = eval(interp, root);
+  }
+  return result;
+}
+
+Cell* define_native(Interpreter& interp, const char* name,
+		    NativeProcedureCell::Function function,
+		    int min_args, int max_args, void* data)
+{
+  Cell* native = make_native(make_symbol(name), function, min_args, max_args, data);
+  interp.global_env().assign(name, native);
+  return native;
+}
+
+void define_value(Interpreter& interp, const char* name, Cell* const value)
+{
+  if (procedurep(value) || nativep(value)) {
+    value->set_name(make_symbol(name));
+  }
+  interp.global_env().assign(name, value);
+}
+
+Cell* lookup_value(Interpreter& interp, const char* name) throw (runtime_error)
+{
+  return eval(interp, make_symbol(name));
+}
+
+Cell* call(Interpreter& interp, Cell* const procedure, Cell* const argv[], int argc) throw (runtime_error)
+{
+  // the values are quoted, so that evaluating the arguments gives them back
+  Cell* quote = make_symbol("quote");
+  Cell* argv_list = nil;
+  for (int i = argc; i-- > 0; ) {
+    argv_list = cons(cons(quote, cons(argv[i], nil)), argv_list);
+  }
+  return eval(interp, cons(procedure, argv_list));
+}
@@ -0,0 +1,77 @@
+/**
+ * \file microlisp.hpp
+ *
+ * Encapsulates the interface for embedding the interpreter in a C++
+ * program, linked from libmicrolisp.a. A program creates an Interpreter,
+ * defines the C++ functions it wants to offer as procedures, evaluates
+ * source text straight from its own buffers, and exchanges values with
+ * the interpreter as Cells built with the factories of cons.hpp:
+ *
+ *   Cell* scale(Interpreter& interp, Cell* const argv[], int argc, void* data)
+ *   {
+ *     return make_double(get_double(argv[0]) * *(double*) data);
+ *   }
+ *
+ *   Interpreter interp;
+ *   double factor = 2.5;
+ *   define_native(interp, "scale", scale, 1, 1, &factor);
+ *   Cell* result = eval_buffer(interp, buffer, length);
+ *
+ * Errors are thrown as runtime_error, and the interpreter stays usable.
+ * What print prints collects in interp.out_buffer() until it is flushed.
+ */
+
+#ifndef MICROLISP_HPP
+#define MICROLISP_HPP
+
+#include "cons.hpp"
+#include "Interpreter.hpp"
+#include "eval.hpp"
+#include "parse.hpp"
+#include <cstddef>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * \brief Parse and evaluate every s-expression in the length bytes at
+ * buffer, which are neither copied nor changed, in interp (error if one is
+ * malformed or fails to evaluate; the ones before it stay evaluated).
+ * \return The value of the last s-expression, nil if there is none.
+ */
+Cell* eval_buffer(Interpreter& interp, const char* buffer, size_t length) throw (runtime_error);
+
+/**
+ * \brief Define name in the global environment of interp as the native
+ * procedure implemented by function, taking from min_args to max_args
+ * arguments (NativeProcedureCell::VARIADIC for no limit), and receiving
+ * data with every call.
+ * \return The native procedure cell.
+ */
+Cell* define_native(Interpreter& interp, const char* name,
+		    NativeProcedureCell::Function function,
+		    int min_args, int max_args, void* data = NULL);
+
+/**
+ * \brief Define name in the global environment of interp as value, which
+ * is not evaluated.
+ * \return Void.
+ */
+void define_value(Interpreter& interp, const char* name, Cell* const value);
+
+/**
+ * \brief Look name up in interp as a symbol evaluated at the top level
+ * would be (error if it is not defined).
+ * \return The value of name.
+ */
+Cell* lookup_value(Interpreter& interp, const char* name) throw (runtime_error);
+
+/**
+ * \brief Apply procedure, a procedure, native procedure or builtin, to
+ * the argc values in argv, which are not evaluated again (error if the
+ * application fails).
+ * \return The result of the procedure.
+ */
+Cell* call(Interpreter& interp, Cell* const procedure, Cell* const argv[], int argc) throw (runtime_error);
+
+#endif // MICROLISP_HPP
@@ -0,0 +1,257 @@
+/**
+ * \file number.cpp
+ *
+ * Implementation of the conversion of numbers to and from text. The usual
+ * cases are worked out digit by digit in one pass; the rare ones that
+ * cannot be done exactly that way, such as literals with more digits than
+ * a long long holds, fall back to the C library.
+ */
+
+#include "number.hpp"
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * \brief The powers of ten a double holds exactly.
+ */
+const double EXACT_POWERS[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * \brief The largest power of ten in EXACT_POWERS.
+ */
+const int EXACT_POWER_MAX = 22;
+
+/**
+ * \brief The significant digits of a literal accumulated exactly.
+ */
+const int MANTISSA_DIGITS = 19;
+
+/**
+ * \brief The largest mantissa a double holds exactly, 2^53.
+ */
+const unsigned long long EXACT_MANTISSA_MAX = 1ULL << 53;
+
+/**
+ * \brief The significant figures printed for a double that is not
+ * integral.
+ */
+const int SIGNIFICANT_DIGITS = 6;
+
+/**
+ * \brief The smallest number with SIGNIFICANT_DIGITS digits, and the
+ * smallest with one more.
+ */
+const double SIGNIFICANT_LOW = 1e5;
+const double SIGNIFICANT_HIGH = 1e6;
+
+/**
+ * \brief How far from a tie between two roundings a scaled value must be
+ * for the rounding to be trusted; the scaling is off by less than 1e-10.
+ */
+const double TIE_MARGIN = 1e-9;
+
+NumberKind scan_number(const char* begin, const char* end, int& int_value, double& double_value)
+{
+  const char* pos = begin;
+  if (pos == end) {
+    return NUMBER_NONE;
+  }
+  bool negative = false;
+  if (*pos == '+' || *pos == '-') {
+    if (end - begin == 1) {
+      return NUMBER_NONE;
+    }
+    negative = (*pos == '-');
+    ++pos;
+  } else if ((*pos < '0' || *pos > '9') && *pos != '.') {
+    return NUMBER_NONE;
+  }
+
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digit = false;
+  bool dot = false;
+  bool exact = true;
+  for (; pos < end; ++pos) {
+    char ch = *pos;
+    if (ch >= '0' && ch <= '9') {
+      any_digit = true;
+      if (digits < MANTISSA_DIGITS) {
+	mantissa = mantissa * 10 + (ch - '0');
+	// leading zeros are not significant
+	if (mantissa != 0) {
+	  ++digits;
+	}
+	if (dot) {
+	  --exponent;
+	}
+      } else {
+	exact = false;
+	if (!dot) {
+	  ++exponent;
+	}
+      }
+    } else if (ch == '.' && !dot) {
+      dot = true;
+    } else {
+      return NUMBER_ILLEGAL;
+    }
+  }
+
+  if (!dot) {
+    // saturate at the range of long, then wrap around to int, as atoi does
+    unsigned long long limit = negative ? (unsigned long long) LONG_MAX + 1 : LONG_MAX;
+    if (!exact || mantissa > limit) {
+      mantissa = limit;
+    }
+    int_value = (int) (negative ? (long) (0 - mantissa) : (long) mantissa);
+    return NUMBER_INT;
+  }
+
+  if (!any_digit) {
+    double_value = 0.0;
+  } else if (exact && mantissa <= EXACT_MANTISSA_MAX && -exponent <= EXACT_POWER_MAX) {
+    // both operands are exact, so the one rounding gives the nearest double
+    double_value = (double) mantissa / EXACT_POWERS[-exponent];
+    if (negative) {
+      double_value = -double_value;
+    }
+  } else {
+    double_value = strtod(string(begin, end).c_str(), NULL);
+  }
+  return NUMBER_DOUBLE;
+}
+
+/**
+ * \brief Append the decimal digits of value to out.
+ * \return Void.
+ */
+void append_digits(string& out, unsigned long long value)
+{
+  char digits[20];
+  char* pos = digits + sizeof(digits);
+  do {
+    *--pos = (char) ('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  out.append(pos, digits + sizeof(digits) - pos);
+}
+
+/**
+ * \brief Append value to out formatted by snprintf.
+ * \return Void.
+ */
+void append_printf(string& out, const char* format, double value)
+{
+  // the largest double takes 309 digits before ".0"
+  char digits[320];
+  out.append(digits, snprintf(digits, sizeof(digits), format, value));
+}
+
+/**
+ * \brief Multiply value by 10^shift, |shift| <= EXACT_POWER_MAX, with one
+ * rounding.
+ * \return The scaled value.
+ */
+double scale10(double value, int shift)
+{
+  return shift >= 0 ? value * EXACT_POWERS[shift] : value / EXACT_POWERS[-shift];
+}
+
+void append_int(string& out, int value)
+{
+  if (value < 0) {
+    out += '-';
+    append_digits(out, 0ULL - (long long) value);
+  } else {
+    append_digits(out, value);
+  }
+}
+
+void append_double(string& out, double value)
+{
+  double magnitude = fabs(value);
+  if (trunc(value) == value) {
+    // print "x.0" instead of "x"; infinities fall back too
+    if (magnitude >= 1e19) {
+      append_printf(out, "%.1f", value);
+      return;
+    }
+    if (signbit(value)) {
+      out += '-';
+    }
+    append_digits(out, (unsigned long long) magnitude);
+    out += ".0";
+    return;
+  }
+
+  // round to SIGNIFICANT_DIGITS digits, scaled to an integer, where the
+  // scaling is exact enough; nans and tiny numbers fall back
+  int exponent = value == value ? (int) floor(log10(magnitude)) : 0;
+  int shift = SIGNIFICANT_DIGITS - 1 - exponent;
+  double scaled = 0;
+  if (value == value && shift <= EXACT_POWER_MAX) {
+    scaled = scale10(magnitude, shift);
+    // log10 may be one off next to a power of ten
+    if (scaled < SIGNIFICANT_LOW && shift < EXACT_POWER_MAX) {
+      --exponent;
+      scaled = scale10(magnitude, ++shift);
+    } else if (scaled >= SIGNIFICANT_HIGH) {
+      ++exponent;
+      scaled = scale10(magnitude, --shift);
+    }
+  }
+  double whole = floor(scaled);
+  if (scaled < SIGNIFICANT_LOW || scaled >= SIGNIFICANT_HIGH
+      || fabs(scaled - whole - 0.5) < TIE_MARGIN) {
+    append_printf(out, "%.6g", value);
+    return;
+  }
+  unsigned long rounded = (unsigned long) whole + (scaled - whole > 0.5 ? 1 : 0);
+  if (rounded == (unsigned long) SIGNIFICANT_HIGH) {
+    rounded /= 10;
+    ++exponent;
+  }
+  char digits[SIGNIFICANT_DIGITS];
+  for (int i = SIGNIFICANT_DIGITS; i-- > 0; ) {
+    digits[i] = (char) ('0' + rounded % 10);
+    rounded /= 10;
+  }
+  // as "%g", drop the trailing zeros of the fraction
+  int length = SIGNIFICANT_DIGITS;
+  while (length > 1 && digits[length - 1] == '0') {
+    --length;
+  }
+
+  if (value < 0) {
+    out += '-';
+  }
+  if (exponent < -4 || exponent >= SIGNIFICANT_DIGITS) {
+    out += digits[0];
+    if (length > 1) {
+      out += '.';
+      out.append(digits + 1, length - 1);
+    }
+    out += exponent < 0 ? "e-" : "e+";
+    if (abs(exponent) < 10) {
+      out += '0';
+    }
+    append_digits(out, abs(exponent));
+  } else if (exponent >= 0) {
+    out.append(digits, exponent + 1);
+    if (length > exponent + 1) {
+      out += '.';
+      out.append(digits + exponent + 1, length - exponent - 1);
+    }
+  } else {
+    out += "0.";
+    out.append(-exponent - 1, '0');
+    out.append(digits, length);
+  }
+}
@@ -0,0 +1,48 @@
+/**
+ * \file number.hpp
+ *
+ * Encapsulates the conversion of numeric literals to ints and doubles, and
+ * of ints and doubles back to text, without streams or the locale.
+ */
+
+#ifndef NUMBER_HPP
+#define NUMBER_HPP
+
+#include <string>
+
+using namespace std;
+
+/**
+ * \brief What scan_number() found.
+ */
+typedef enum e_number_kind {
+  NUMBER_NONE, NUMBER_INT, NUMBER_DOUBLE, NUMBER_ILLEGAL
+} NumberKind;
+
+/**
+ * \brief Classify the atom from begin to end, and convert it if it is a
+ * numeric literal, in one pass. An atom starting with a digit or a dot, or
+ * with a sign and longer than it, is a numeric literal; it is legal if the
+ * rest are digits with at most one dot, a double if it has a dot, and an
+ * int otherwise, wrapping around like atoi when it is too large.
+ * \return NUMBER_NONE for a symbol, NUMBER_ILLEGAL for a malformed
+ * literal, otherwise the kind of value stored in int_value or
+ * double_value.
+ */
+NumberKind scan_number(const char* begin, const char* end, int& int_value, double& double_value);
+
+/**
+ * \brief Append the decimal digits of value to out.
+ * \return Void.
+ */
+void append_int(string& out, int value);
+
+/**
+ * \brief Append value to out as the interpreter prints doubles: with ".0"
+ * if it is integral, otherwise to at most 6 significant figures, as
+ * printf's "%.1f" and "%.6g" respectively.
+ * \return Void.
+ */
+void append_double(string& out, double value);
+
+#endif // NUMBER_HPP
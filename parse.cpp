@@ -6,7 +6,22 @@
  */
 
 #include "parse.hpp"
-bool inparsecar;
+#include "number.hpp"
+#include <vector>
+
+/**
+ * \brief Share a freshly parsed cell with an equal one parsed before, if
+ * hash-consing is on in interp.
+ * \param interp The interpreter owning the hash-consing table.
+ * \param c The freshly parsed cell.
+ * \return The shared cell equal to c.
+ */
+Cell* hashcons(Interpreter& interp, Cell* const c)
+{
+  HashConsTable* table = interp.hashcons();
+  return table == NULL ? c : table->share(c);
+}
+
 // check whether chr is white space
 bool iswhitespace(char ch)
 {
@@ -131,17 +146,19 @@ void clearwhitespace(string& sexpr)
 }
 
 /**
- * \brief Check whether the s-expression legal
+ * \brief Check whether the s-expression legal, reporting the problem on
+ * the output of interp if it is not. The results buffered so far are
+ * written out only then, not for every legal s-expression.
  */
-bool is_legalexpr(string sexpr)
+bool is_legalexpr(string sexpr, Interpreter& interp)
 {
   clearwhitespace(sexpr);
   if (sexpr.length()==0) {
-    cout << "blank string " << endl;
+    interp.out() << "blank string " << endl;
     return false;
   }
   if (')' == sexpr[0]) {
-    cout << "error: illegal s-expression" << endl;
+    interp.out() << "error: illegal s-expression" << endl;
     return false;
   }
   if ('(' == sexpr[0]) {
@@ -164,18 +181,18 @@ bool is_legalexpr(string sexpr)
       }
     }
     if ((i < length - 1) || (i == length) || (inumleftparenthesis > 0) || 0 != quotationmark) {
-      cout << "error: illegal s-expression " << endl;
+      interp.out() << "error: illegal s-expression " << endl;
       return false;
     }
   } else if ('\"' != sexpr[0]) {
     // single element
     if (string::npos != sexpr.find('(') || string::npos != sexpr.find(')') || string::npos != sexpr.find(' ') || string::npos != sexpr.find('\"'))  {
-      cout << "error: illegal s-expression " << endl;
+      interp.out() << "error: illegal s-expression " << endl;
       return false;
     }
     // check whether str is illegal numeric literal or illegal operator
     if ((false == is_legalnumeric(sexpr)) && (false ==is_legaloperator(sexpr))) {
-      cout << "error: illegal numeric literal or illegal operator" << endl;
+      interp.out() << "error: illegal numeric literal or illegal operator" << endl;
       return false;
     }
   } else {
@@ -191,7 +208,7 @@ bool is_legalexpr(string sexpr)
       }
     }
     if ((i < length-1) || (inumleft != 2)) {
-      cout << "error: illegal s-expression " << endl;
+      interp.out() << "error: illegal s-expression " << endl;
       return false;
     }
   }
@@ -205,24 +222,16 @@ bool is_legalexpr(string sexpr)
 Cell* makecell(string str)
 {
   Cell* root;
-  if (((str[0] >= '0') && (str[0] <= '9')) || (str[0] == '.') 
-      || ((('+'==str[0]) || ('-'==str[0]))&&(str.length()>1))) {
-    if (false == is_legalnumeric(str)) {
-      cout << "error: illegal numeric literal" << endl;
-      exit(1);
-    }
-    // this is a numeric literal
-    if (string::npos == str.find('.')) {
-      // int number
-      char* fchar = const_cast<char*>(str.c_str());
-      int value = atoi(fchar);
-      root = make_int(value);
-    } else {
-      // this is a double
-      char* fchar = const_cast<char*>(str.c_str());
-      double value = atof(fchar);   
-      root = make_double(value);
-    }
+  int int_value;
+  double double_value;
+  NumberKind kind = scan_number(str.data(), str.data() + str.size(), int_value, double_value);
+  if (NUMBER_ILLEGAL == kind) {
+    cout << "error: illegal numeric literal" << endl;
+    exit(1);
+  } else if (NUMBER_INT == kind) {
+    root = make_int(int_value);
+  } else if (NUMBER_DOUBLE == kind) {
+    root = make_double(double_value);
   } 
   
   // we don't deal with literal strings right now, so they are commented out
@@ -242,9 +251,9 @@ Cell* makecell(string str)
   return root;
 }
 
-Cell* separate_parse(string& sexpr); 
+Cell* separate_parse(Interpreter& interp, string& sexpr);
 
-Cell* parse(string sexpr)
+Cell* parse(Interpreter& interp, string sexpr)
 {
   // is_legal(sexpr);
   // delete the whitesapce at the begining and end
@@ -256,7 +265,7 @@ Cell* parse(string sexpr)
   if (sexpr.length() == 0) {
     return NULL;
   }
-  if ( !is_legalexpr(sexpr)) {
+  if ( !is_legalexpr(sexpr, interp)) {
     return NULL;
   }
   // check whether is single symbol
@@ -265,7 +274,7 @@ Cell* parse(string sexpr)
   if ('(' != sexpr[0]) {
     // this is leaf cell
     // bulid this leaf cell
-    Cell* root = makecell( sexpr );
+    Cell* root = hashcons(interp, makecell( sexpr ));
     return root;
   }
 
@@ -282,7 +291,7 @@ Cell* parse(string sexpr)
 //     }
 //   }
   // separate the s-expression into two left and right subsexps
-  Cell* root = separate_parse(sexpr);
+  Cell* root = separate_parse(interp, sexpr);
 
   return root;
 }
@@ -292,7 +301,7 @@ Cell* parse(string sexpr)
  * \param instr The string which consists of s-expressions.
  * \return A pointer to the conspair cell at the root of the parse tree.
  */
-Cell* separate_parse(string& instr)
+Cell* separate_parse(Interpreter& interp, string& instr)
 {
   string sexp;
   bool isstartsexp = false;
@@ -317,11 +326,9 @@ Cell* separate_parse(string& instr)
 	// read single a single symbol
 	readsinglesymbol(instr, sexp);
 	clearwhitespace(instr);  
-	inparsecar = true;
-	Cell* car = parse(sexp);
-	inparsecar = false;
-	Cell* cdr = parse("(" + instr + ")");
-	Cell* root = cons(car, cdr);
+	Cell* car = parse(interp, sexp);
+	Cell* cdr = parse(interp, "(" + instr + ")");
+	Cell* root = hashcons(interp, cons(car, cdr));
 	sexp.clear();
 	return root;
       } else {
@@ -355,18 +362,16 @@ Cell* separate_parse(string& instr)
 	      // current s-expression ends
 	      isstartsexp = false;
 	      clearwhitespace(instr);
-	      inparsecar = true;
-	      Cell* car = parse(sexp);        
-	      inparsecar = false;
+	      Cell* car = parse(interp, sexp);        
 	      int length = instr.length();
 	      Cell* cdr;
 	      Cell* root;
 	      if (length <= 0) {
 		cdr = NULL;
 	      } else {
-		cdr = parse("(" + instr + ")");       
+		cdr = parse(interp, "(" + instr + ")");       
 	      }
-	      root = cons(car, cdr);
+	      root = hashcons(interp, cons(car, cdr));
 	      sexp.clear();
 	      return root;     
 	    }
@@ -378,3 +383,90 @@ Cell* separate_parse(string& instr)
 
   return NULL;
 }
+
+/**
+ * \brief Skip the whitespace starting at pos.
+ * \return Void.
+ */
+void skip_whitespace(const char*& pos, const char* end)
+{
+  while (pos < end && iswhitespace(*pos)) {
+    ++pos;
+  }
+}
+
+/**
+ * \brief Parse the atom starting at pos: a numeric literal, or a symbol,
+ * which may be a string literal as makecell() sees it.
+ * \return The leaf cell.
+ */
+Cell* parse_atom(Interpreter& interp, const char*& pos, const char* end) throw (runtime_error)
+{
+  const char* start = pos;
+  if (*pos == '\"') {
+    for (++pos; pos < end && *pos != '\"'; ++pos) {
+    }
+    if (pos == end) {
+      throw runtime_error("illegal string");
+    }
+    ++pos;
+  } else {
+    while (pos < end && !iswhitespace(*pos) && *pos != '(' && *pos != ')' && *pos != '\"') {
+      ++pos;
+    }
+  }
+  int int_value;
+  double double_value;
+  switch (scan_number(start, pos, int_value, double_value)) {
+  case NUMBER_ILLEGAL:
+    throw runtime_error("illegal numeric literal " + string(start, pos));
+  case NUMBER_INT:
+    return hashcons(interp, make_int(int_value));
+  case NUMBER_DOUBLE:
+    return hashcons(interp, make_double(double_value));
+  default:
+    return hashcons(interp, make_symbol(string(start, pos).c_str()));
+  }
+}
+
+/**
+ * \brief Parse the s-expression starting at pos, which is not whitespace.
+ * \return The root of its parse tree.
+ */
+Cell* parse_sexpr(Interpreter& interp, const char*& pos, const char* end) throw (runtime_error)
+{
+  if (*pos == ')') {
+    throw runtime_error("illegal s-expression: unbalanced )");
+  } else if (*pos != '(') {
+    return parse_atom(interp, pos, end);
+  }
+  ++pos;
+  // Remark: the elements are collected first, as the list is consed from
+  // its end, the same way parse() shares its tails
+  vector<Cell*> elements;
+  for (;;) {
+    skip_whitespace(pos, end);
+    if (pos == end) {
+      throw runtime_error("illegal s-expression: missing )");
+    } else if (*pos == ')') {
+      ++pos;
+      break;
+    }
+    elements.push_back(parse_sexpr(interp, pos, end));
+  }
+  Cell* root = nil;
+  for (vector<Cell*>::size_type i = elements.size(); i-- > 0; ) {
+    root = hashcons(interp, cons(elements[i], root));
+  }
+  return root;
+}
+
+bool parse_next(Interpreter& interp, const char*& pos, const char* end, Cell*& root) throw (runtime_error)
+{
+  skip_whitespace(pos, end);
+  if (pos == end) {
+    return false;
+  }
+  root = parse_sexpr(interp, pos, end);
+  return true;
+}
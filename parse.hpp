@@ -10,18 +10,32 @@
 #define PARSE_HPP
 
 #include "cons.hpp"
+#include "Interpreter.hpp"
+#include <stdexcept>
 
 using namespace std;
 
 /**
  * \brief Recursively parse sexpr and build the parse tree.  \param
+ * interp The interpreter whose parser tables are used.  \param
  * sexpr The s-expression stored in a string variable (note that this
  * version of parse has side effects: it may alter the contents of
  * sexpr).
  *
  * \return A pointer to the conspair cell at the root of the parse tree.
  */
-Cell* parse(string sexpr);
+Cell* parse(Interpreter& interp, string sexpr);
+
+/**
+ * \brief Parse the next s-expression of the buffer ending at end, starting
+ * at pos, in place (error if the s-expression is malformed).
+ * \param interp The interpreter whose parser tables are used.
+ * \param pos Where to start; moved past the s-expression parsed.
+ * \param end The end of the buffer.
+ * \param root Set to the root of the parse tree.
+ * \return False iff only whitespace was left.
+ */
+bool parse_next(Interpreter& interp, const char*& pos, const char* end, Cell*& root) throw (runtime_error);
 
 /**
  * \brief Check whether the character is whitespace.
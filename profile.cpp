@@ -0,0 +1,318 @@
+/**
+ * \file profile.cpp
+ *
+ * Implementation of the sampling profiler. The SIGPROF handler copies the
+ * shadow stack of the interrupted thread into one preallocated buffer,
+ * each sample stored as its depth followed by its frames, so that the
+ * handler neither allocates nor locks. Samples are only turned into names
+ * once sampling stops.
+ */
+
+#include "profile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+bool profile_enabled = false;
+bool profile_counting = false;
+
+thread_local Cell* shadow_stack[SHADOW_STACK_SIZE];
+thread_local int shadow_depth = 0;
+
+/**
+ * \brief Number of words in the sample buffer, enough for hours of
+ * samples of moderately deep stacks.
+ */
+const size_t SAMPLE_BUFFER_SIZE = 1 << 22;
+
+/**
+ * \brief Marks the end of the samples in a full buffer.
+ */
+const uintptr_t SAMPLE_END = ~(uintptr_t) 0;
+
+uintptr_t* sample_buffer = NULL;
+atomic<size_t> sample_used(0);
+atomic<long> samples_dropped(0);
+
+/**
+ * \brief The SIGPROF handler.
+ */
+void take_sample(int)
+{
+  int depth = shadow_depth;
+  atomic_signal_fence(memory_order_acquire);
+  size_t n = depth < SHADOW_STACK_SIZE ? depth : SHADOW_STACK_SIZE;
+  size_t at = sample_used.fetch_add(n + 1, memory_order_relaxed);
+  if (at + n + 1 > SAMPLE_BUFFER_SIZE) {
+    if (at < SAMPLE_BUFFER_SIZE) {
+      sample_buffer[at] = SAMPLE_END; // only the first sample not to fit
+    }
+    ++samples_dropped;
+    return;
+  }
+  sample_buffer[at] = depth;
+  for (size_t i = 0; i < n; ++i) {
+    sample_buffer[at + 1 + i] = (uintptr_t) shadow_stack[i];
+  }
+}
+
+/**
+ * \brief The name a frame is shown as: the name a procedure was defined
+ * as, or the builtin applied.
+ * \return The name.
+ */
+string frame_name(Cell* const c)
+{
+  if (symbolp(c)) {
+    return get_symbol(c);
+  }
+  Cell* name = get_name(c);
+  return nullp(name) ? "(lambda)" : get_symbol(name);
+}
+
+void start_sampling(int hz) throw (runtime_error)
+{
+  if (sample_buffer == NULL) {
+    sample_buffer = new uintptr_t[SAMPLE_BUFFER_SIZE];
+  }
+  struct sigaction action;
+  action.sa_handler = take_sample;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &action, NULL) != 0) {
+    throw runtime_error("cannot install the profiling signal handler");
+  }
+  profile_enabled = true;
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = 1000000 / hz;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    profile_enabled = false;
+    throw runtime_error("cannot start the profiling timer");
+  }
+}
+
+void stop_sampling(const char* path) throw (runtime_error)
+{
+  struct itimerval timer = {{0, 0}, {0, 0}};
+  setitimer(ITIMER_PROF, &timer, NULL);
+  signal(SIGPROF, SIG_IGN); // a signal still pending must not kill us
+  profile_enabled = profile_counting;
+
+  map<string, long> stacks;
+  size_t used = min(sample_used.load(), SAMPLE_BUFFER_SIZE);
+  for (size_t at = 0; at < used; ) {
+    size_t depth = sample_buffer[at++];
+    if (depth == SAMPLE_END) {
+      break;
+    }
+    size_t n = depth < (size_t) SHADOW_STACK_SIZE ? depth : SHADOW_STACK_SIZE;
+    string stack = "(toplevel)";
+    for (size_t i = 0; i < n; ++i) {
+      stack += ";" + frame_name((Cell*) sample_buffer[at + i]);
+    }
+    if (depth > n) {
+      stack += ";(deeper)";
+    }
+    ++stacks[stack];
+    at += n;
+  }
+  sample_used = 0;
+
+  ofstream fout(path);
+  if (!fout) {
+    throw runtime_error(string("cannot write profile ") + path);
+  }
+  for (map<string, long>::iterator it = stacks.begin(); it != stacks.end(); ++it) {
+    fout << it->first << " " << it->second << endl;
+  }
+  if (samples_dropped > 0) {
+    cerr << "profile: " << samples_dropped << " samples dropped, the buffer was full" << endl;
+  }
+}
+
+/**
+ * \struct CallStats
+ * \brief The calls of one procedure or builtin. Time is in nanoseconds of
+ * steady_clock, allocations in cells constructed. Exclusive figures leave
+ * out the calls made from within; inclusive ones count recursive calls
+ * only once.
+ */
+struct CallStats {
+  CallStats() : calls(0), active(0), inclusive_ns(0), exclusive_ns(0),
+		cells_inclusive(0), cells_exclusive(0) {}
+  long calls;
+  long active; // calls under way on this thread
+  long long inclusive_ns;
+  long long exclusive_ns;
+  long cells_inclusive;
+  long cells_exclusive;
+};
+
+/**
+ * \struct CallFrame
+ * \brief A call under way.
+ */
+struct CallFrame {
+  CallStats* stats;
+  long long start_ns;
+  long long child_ns;
+  long cells_start;
+  long child_cells;
+};
+
+/**
+ * \struct ThreadCallStats
+ * \brief The calls counted on one thread. The mutex is only contended
+ * while a report is written.
+ */
+struct ThreadCallStats {
+  mutex m;
+  map<Cell*, CallStats> stats;
+  vector<CallFrame> frames;
+};
+
+mutex thread_stats_mutex;
+vector<ThreadCallStats*> thread_stats; // never freed, as threads may outlive a report
+thread_local ThreadCallStats* current_stats = NULL;
+
+/**
+ * \brief Accessor.
+ * \return Nanoseconds of steady_clock.
+ */
+long long now_ns()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void enter_call(Cell* const procedure)
+{
+  if (current_stats == NULL) {
+    current_stats = new ThreadCallStats();
+    lock_guard<mutex> lock(thread_stats_mutex);
+    thread_stats.push_back(current_stats);
+  }
+  lock_guard<mutex> lock(current_stats->m);
+  CallStats& stats = current_stats->stats[procedure];
+  ++stats.calls;
+  ++stats.active;
+  CallFrame frame = {&stats, now_ns(), 0, cells_constructed, 0};
+  current_stats->frames.push_back(frame);
+}
+
+void leave_call()
+{
+  long long end = now_ns();
+  lock_guard<mutex> lock(current_stats->m);
+  vector<CallFrame>& frames = current_stats->frames;
+  CallFrame frame = frames.back();
+  frames.pop_back();
+  long long elapsed = end - frame.start_ns;
+  long cells = cells_constructed - frame.cells_start;
+  CallStats& stats = *frame.stats;
+  stats.exclusive_ns += elapsed - frame.child_ns;
+  stats.cells_exclusive += cells - frame.child_cells;
+  if (--stats.active == 0) {
+    stats.inclusive_ns += elapsed;
+    stats.cells_inclusive += cells;
+  }
+  if (!frames.empty()) {
+    frames.back().child_ns += elapsed;
+    frames.back().child_cells += cells;
+  }
+}
+
+void start_counting()
+{
+  profile_counting = true;
+  profile_enabled = true;
+}
+
+/**
+ * \brief Order by inclusive time, longest first.
+ * \return True iff a comes before b.
+ */
+bool longer_inclusive(const pair<string, CallStats>& a, const pair<string, CallStats>& b)
+{
+  return a.second.inclusive_ns > b.second.inclusive_ns;
+}
+
+/**
+ * \brief Escape s for use inside a JSON string.
+ * \return The escaped string.
+ */
+string json_escape(const string& s)
+{
+  string escaped;
+  for (string::size_type i = 0; i < s.size(); ++i) {
+    if (s[i] == '"' || s[i] == '\\') {
+      escaped += '\\';
+    }
+    escaped += s[i];
+  }
+  return escaped;
+}
+
+void write_call_stats(ostream& os, bool json)
+{
+  // calls of distinct procedures of the same name are reported together
+  map<string, CallStats> by_name;
+  {
+    lock_guard<mutex> lock(thread_stats_mutex);
+    for (vector<ThreadCallStats*>::size_type i = 0; i < thread_stats.size(); ++i) {
+      lock_guard<mutex> thread_lock(thread_stats[i]->m);
+      map<Cell*, CallStats>& stats = thread_stats[i]->stats;
+      for (map<Cell*, CallStats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+	CallStats& total = by_name[frame_name(it->first)];
+	total.calls += it->second.calls;
+	total.inclusive_ns += it->second.inclusive_ns;
+	total.exclusive_ns += it->second.exclusive_ns;
+	total.cells_inclusive += it->second.cells_inclusive;
+	total.cells_exclusive += it->second.cells_exclusive;
+      }
+    }
+  }
+  vector<pair<string, CallStats> > rows(by_name.begin(), by_name.end());
+  stable_sort(rows.begin(), rows.end(), longer_inclusive);
+
+  if (json) {
+    os << "[";
+    for (vector<pair<string, CallStats> >::size_type i = 0; i < rows.size(); ++i) {
+      const CallStats& stats = rows[i].second;
+      os << (i == 0 ? "\n" : ",\n")
+	 << "  {\"name\": \"" << json_escape(rows[i].first) << "\""
+	 << ", \"calls\": " << stats.calls
+	 << ", \"inclusive_ns\": " << stats.inclusive_ns
+	 << ", \"exclusive_ns\": " << stats.exclusive_ns
+	 << ", \"cells_inclusive\": " << stats.cells_inclusive
+	 << ", \"cells_exclusive\": " << stats.cells_exclusive << "}";
+    }
+    os << "\n]" << endl;
+    return;
+  }
+  ios::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  os << left << setw(24) << "name" << right
+     << setw(12) << "calls"
+     << setw(14) << "incl ms" << setw(14) << "excl ms"
+     << setw(14) << "incl cells" << setw(14) << "excl cells" << endl;
+  os << fixed << setprecision(3);
+  for (vector<pair<string, CallStats> >::size_type i = 0; i < rows.size(); ++i) {
+    const CallStats& stats = rows[i].second;
+    os << left << setw(24) << rows[i].first << right
+       << setw(12) << stats.calls
+       << setw(14) << stats.inclusive_ns / 1e6 << setw(14) << stats.exclusive_ns / 1e6
+       << setw(14) << stats.cells_inclusive << setw(14) << stats.cells_exclusive << endl;
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
@@ -0,0 +1,145 @@
+/**
+ * \file profile.hpp
+ *
+ * Encapsulates the interface of the sampling profiler. While it runs,
+ * every thread keeps a shadow stack of the procedures it is applying, and
+ * a SIGPROF timer records that stack at a fixed rate of CPU time. The
+ * samples are written as folded stacks, one "outer;...;inner count" line
+ * per distinct stack, as consumed by flamegraph.pl.
+ *
+ * Independently, every call of a procedure or builtin can be counted and
+ * timed exactly, with the cells constructed during the call attributed to
+ * it, and reported per name.
+ */
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "cons.hpp"
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * \brief Whether apply() and the builtin dispatch create ProfileFrames,
+ * that is whether sampling or counting is on. Only changed while no
+ * evaluation is running.
+ */
+extern bool profile_enabled;
+
+/**
+ * \brief Whether ProfileFrames count and time calls.
+ */
+extern bool profile_counting;
+
+/**
+ * \brief Deepest shadow stack kept per thread; deeper frames are counted
+ * but not recorded.
+ */
+const int SHADOW_STACK_SIZE = 1024;
+
+/**
+ * \brief The procedures being applied by the calling thread, outermost
+ * first.
+ */
+extern thread_local Cell* shadow_stack[SHADOW_STACK_SIZE];
+
+/**
+ * \brief Number of procedures being applied by the calling thread.
+ */
+extern thread_local int shadow_depth;
+
+/**
+ * \brief Start counting and timing the call of procedure, or of the builtin
+ * named by the symbol procedure, on the calling thread.
+ * \return Void.
+ */
+void enter_call(Cell* const procedure);
+
+/**
+ * \brief Finish counting and timing the innermost call started by
+ * enter_call() on the calling thread.
+ * \return Void.
+ */
+void leave_call();
+
+/**
+ * \class ProfileFrame
+ * \brief Class ProfileFrame. Keeps a procedure on the shadow stack of the
+ * calling thread, and its call counted, for as long as the frame lives.
+ * Builtins are counted but left off the shadow stack, so that samples only
+ * show procedures.
+ */
+class ProfileFrame {
+
+public:
+
+  /**
+   * \brief Constructor of the ProfileFrame, pushing procedure.
+   */
+  ProfileFrame(Cell* const procedure, bool shadowed = true)
+    : shadowed_m(shadowed), counted_m(profile_counting)
+  {
+    if (shadowed_m) {
+      if (shadow_depth < SHADOW_STACK_SIZE) {
+	shadow_stack[shadow_depth] = procedure;
+      }
+      // the signal handler must never see the new depth before the frame
+      atomic_signal_fence(memory_order_release);
+      ++shadow_depth;
+    }
+    if (counted_m) {
+      enter_call(procedure);
+    }
+  }
+
+  /**
+   * \brief Destructor of the ProfileFrame, popping its procedure.
+   */
+  ~ProfileFrame()
+  {
+    if (counted_m) {
+      leave_call();
+    }
+    if (shadowed_m) {
+      --shadow_depth;
+      atomic_signal_fence(memory_order_release);
+    }
+  }
+
+private:
+  ProfileFrame(const ProfileFrame&);
+  ProfileFrame& operator= (const ProfileFrame&);
+
+  bool shadowed_m;
+  bool counted_m;
+
+};
+
+/**
+ * \brief Start sampling the shadow stacks of all threads, hz times per
+ * second of CPU time (error if the timer cannot be set up).
+ */
+void start_sampling(int hz) throw (runtime_error);
+
+/**
+ * \brief Stop sampling and write the folded stacks to the file at path
+ * (error if the file cannot be written).
+ */
+void stop_sampling(const char* path) throw (runtime_error);
+
+/**
+ * \brief Start counting and timing every call.
+ * \return Void.
+ */
+void start_counting();
+
+/**
+ * \brief Write the calls counted so far on all threads, one entry per
+ * name sorted by inclusive time, as a table or as a JSON array.
+ * \return Void.
+ */
+void write_call_stats(ostream& os, bool json);
+
+#endif // PROFILE_HPP
@@ -0,0 +1,498 @@
+/**
+ * \file serve.cpp
+ *
+ * Implementation of the REPL server.
+ */
+
+#include "serve.hpp"
+#include "parse.hpp"
+#include "eval.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/**
+ * \brief Events taken from epoll at a time.
+ */
+const int MAX_EVENTS = 64;
+
+/**
+ * \brief Bytes read from a connection at a time.
+ */
+const size_t READ_SIZE = 64 * 1024;
+
+/**
+ * \brief The longest request line taken; a connection sending a longer
+ * one is closed.
+ */
+const size_t MAX_REQUEST_SIZE = 16 * 1024 * 1024;
+
+/**
+ * \brief The epoll keys of the listening socket and of the reply queue;
+ * the connections are numbered from FIRST_CONNECTION up, and never reuse
+ * a number, so that a late reply cannot reach a later client.
+ */
+const uint64_t LISTENER_KEY = 0;
+const uint64_t REPLIES_KEY = 1;
+const uint64_t FIRST_CONNECTION = 2;
+
+/**
+ * \struct Connection
+ * \brief The state of one client: what it sent that is not yet a whole
+ * request, the replies not yet written to it, and those that came back
+ * before the reply to an earlier request.
+ */
+struct Connection {
+  int fd;
+  string in;
+  string out;
+  bool closing;
+  unsigned long requests;              // requests taken so far
+  unsigned long replies;               // replies moved to out so far
+  map<unsigned long, string> waiting;  // replies that came back early, by request
+};
+
+/**
+ * \brief Throw the error of the last failed system call.
+ * \return Never.
+ */
+void throw_errno(const string& what) throw (runtime_error)
+{
+  throw runtime_error(what + ": " + strerror(errno));
+}
+
+/**
+ * \brief Make the reads and writes of fd return instead of waiting.
+ * \return Void.
+ */
+void set_nonblocking(int fd) throw (runtime_error)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    throw_errno("cannot make the socket nonblocking");
+  }
+}
+
+/**
+ * \class ReplyQueue
+ * \brief Class ReplyQueue. Hands the replies of the requests evaluated on
+ * the worker pool back to the thread running the server, and wakes it
+ * through an eventfd in its epoll set.
+ */
+class ReplyQueue {
+
+public:
+
+  /**
+   * \struct Reply
+   * \brief The reply to the request numbered request of a connection.
+   */
+  struct Reply {
+    uint64_t connection;
+    unsigned long request;
+    string text;
+  };
+
+  /**
+   * \brief Constructor of the ReplyQueue (error if the eventfd cannot be
+   * made).
+   */
+  ReplyQueue() throw (runtime_error)
+    : fd_m(eventfd(0, EFD_NONBLOCK))
+  {
+    if (fd_m < 0) {
+      throw_errno("cannot create the reply queue");
+    }
+  }
+
+  /**
+   * \brief Destructor of the ReplyQueue.
+   */
+  ~ReplyQueue()
+  {
+    close(fd_m);
+  }
+
+  /**
+   * \brief Accessor.
+   * \return The eventfd readable while replies are queued.
+   */
+  int fd() const
+  {
+    return fd_m;
+  }
+
+  /**
+   * \brief Queue reply, from any thread.
+   * \return Void.
+   */
+  void post(const Reply& reply)
+  {
+    {
+      lock_guard<mutex> lock(mutex_m);
+      replies_m.push_back(reply);
+    }
+    // only an overflowing counter fails, and then the queue is awake anyway
+    uint64_t one = 1;
+    ssize_t written = write(fd_m, &one, sizeof(one));
+    (void) written;
+  }
+
+  /**
+   * \brief Take every reply queued so far.
+   * \return The replies, in the order they were posted.
+   */
+  vector<Reply> take()
+  {
+    uint64_t count;
+    ssize_t n = read(fd_m, &count, sizeof(count));
+    (void) n;
+    vector<Reply> replies;
+    lock_guard<mutex> lock(mutex_m);
+    replies.swap(replies_m);
+    return replies;
+  }
+
+private:
+  ReplyQueue(const ReplyQueue&);
+  ReplyQueue& operator= (const ReplyQueue&);
+
+  int fd_m;
+  mutex mutex_m;
+  vector<Reply> replies_m;
+
+};
+
+/**
+ * \brief Format a reply: the header, then results and errors.
+ * \return The reply.
+ */
+string make_reply(const string& results, const string& errors, long micros)
+{
+  ostringstream reply;
+  reply << results.size() << ' ' << errors.size() << ' ' << micros << '\n'
+	<< results << errors;
+  return reply.str();
+}
+
+/**
+ * \brief Evaluate the s-expressions of request one by one on a copy of the
+ * definitions of proto, as the batch driver does.
+ * \return The reply.
+ */
+string answer(Interpreter& proto, const string& request)
+{
+  // a pool thread may take the request while waiting in a parallel
+  // evaluation, whose budget is not the one of the request
+  BudgetScope scope(NULL);
+  ostringstream out;
+  ostringstream err;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  {
+    Interpreter interp(proto, out, err);
+    const char* pos = request.data();
+    const char* end = pos + request.size();
+    Cell* root;
+    try {
+      while (parse_next(interp, pos, end, root)) {
+	try {
+	  interp.out_buffer().print_line(eval(interp, root));
+	} catch (runtime_error &e) {
+	  interp.err() << "ERROR: " << e.what() << endl;
+	}
+      }
+    } catch (runtime_error &e) {
+      // the rest of a malformed request cannot be parsed
+      interp.err() << "ERROR: " << e.what() << endl;
+    } catch (logic_error &e) {
+      // the copy is thrown away, so the server can go on
+      interp.err() << "LOGIC ERROR: " << e.what() << endl;
+    } catch (exception &e) {
+      // bad_alloc among others, which fail the request and not the server
+      interp.err() << "ERROR: " << e.what() << endl;
+    }
+    interp.out_buffer().flush();
+  }
+  long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+  return make_reply(out.str(), err.str(), micros);
+}
+
+/**
+ * \brief Evaluate request on the worker pool, and post the reply to
+ * replies as the next one of the connection numbered key. Without
+ * background workers in the pool, it is evaluated on the calling thread.
+ * \return Void.
+ */
+void start_request(Interpreter& proto, const shared_ptr<ReplyQueue>& replies,
+		   uint64_t key, Connection& conn, const string& request)
+{
+  unsigned long number = conn.requests++;
+  ThreadPool::Task task = [&proto, replies, key, number, request] {
+    ReplyQueue::Reply reply = {key, number, ""};
+    try {
+      reply.text = answer(proto, request);
+    } catch (exception &e) {
+      // even copying the definitions failed; the client still gets a reply
+      reply.text = make_reply("", string("ERROR: ") + e.what() + "\n", 0);
+    }
+    replies->post(reply);
+  };
+  ThreadPool& pool = worker_pool();
+  if (pool.threads() > 1) {
+    pool.submit(task);
+  } else {
+    task();
+  }
+}
+
+/**
+ * \brief Read what the client of conn sent, and start every whole request
+ * line in it; the end of the input ends the last request too.
+ * \return Void.
+ */
+void read_requests(Interpreter& proto, const shared_ptr<ReplyQueue>& replies,
+		   uint64_t key, Connection& conn)
+{
+  char buffer[READ_SIZE];
+  while (true) {
+    ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+    if (n > 0) {
+      conn.in.append(buffer, n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+	conn.closing = true;
+      }
+      break;
+    }
+  }
+
+  string::size_type begin = 0;
+  string::size_type newline;
+  while ((newline = conn.in.find('\n', begin)) != string::npos) {
+    start_request(proto, replies, key, conn, conn.in.substr(begin, newline - begin));
+    begin = newline + 1;
+  }
+  conn.in.erase(0, begin);
+  if (conn.closing && conn.in.find_first_not_of(" \t\r") != string::npos) {
+    start_request(proto, replies, key, conn, conn.in);
+    conn.in.clear();
+  } else if (conn.in.size() > MAX_REQUEST_SIZE) {
+    conn.in.clear();
+    conn.out.clear();
+    conn.closing = true;
+    // the replies still to come are of no use
+    conn.replies = conn.requests;
+    conn.waiting.clear();
+  }
+}
+
+/**
+ * \brief Move the replies that came back to the connections they are for,
+ * each after the replies to the earlier requests of its connection.
+ * Replies for connections closed since are dropped.
+ * \return The keys of the connections that got replies.
+ */
+vector<uint64_t> deliver_replies(ReplyQueue& replies, map<uint64_t, Connection>& connections)
+{
+  vector<ReplyQueue::Reply> ready = replies.take();
+  vector<uint64_t> keys;
+  for (vector<ReplyQueue::Reply>::size_type i = 0; i < ready.size(); ++i) {
+    map<uint64_t, Connection>::iterator it = connections.find(ready[i].connection);
+    if (it == connections.end() || ready[i].request < it->second.replies) {
+      continue;
+    }
+    keys.push_back(it->first);
+    Connection& conn = it->second;
+    conn.waiting[ready[i].request].swap(ready[i].text);
+    map<unsigned long, string>::iterator next;
+    while ((next = conn.waiting.find(conn.replies)) != conn.waiting.end()) {
+      conn.out += next->second;
+      conn.waiting.erase(next);
+      ++conn.replies;
+    }
+  }
+  return keys;
+}
+
+/**
+ * \brief Write as many of the replies to the client of conn as it takes
+ * now.
+ * \return False if the client is gone.
+ */
+bool write_replies(Connection& conn)
+{
+  string::size_type written = 0;
+  while (written < conn.out.size()) {
+    ssize_t n = send(conn.fd, conn.out.data() + written, conn.out.size() - written, MSG_NOSIGNAL);
+    if (n >= 0) {
+      written += n;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else {
+      return false;
+    }
+  }
+  conn.out.erase(0, written);
+  return true;
+}
+
+/**
+ * \brief Write what is ready for the client of conn, and close it once it
+ * is gone, or has finished and has every reply; otherwise wait for what
+ * it still needs.
+ * \return False if the connection was closed.
+ */
+bool update_connection(int epoll_fd, uint64_t key, Connection& conn)
+{
+  bool alive = write_replies(conn);
+  bool answered = conn.replies == conn.requests && conn.out.empty();
+  if (!alive || (conn.closing && answered)) {
+    // closing the socket also takes it out of the epoll set
+    close(conn.fd);
+    return false;
+  }
+  // wait for room to write only while replies are pending, and for
+  // nothing else once the client has finished
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  if (conn.closing) {
+    event.events = conn.out.empty() ? 0 : (uint32_t) EPOLLOUT;
+  } else {
+    event.events = conn.out.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+  }
+  event.data.u64 = key;
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+  return true;
+}
+
+void serve(Interpreter& proto, const char* path) throw (runtime_error)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    throw runtime_error("socket path too long");
+  }
+  strcpy(addr.sun_path, path);
+
+  // only a socket left by an earlier server is replaced, never a file
+  struct stat st;
+  if (lstat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      throw runtime_error(string(path) + " exists and is not a socket");
+    }
+    unlink(path);
+  }
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    throw_errno("cannot create the socket");
+  }
+  if (bind(listener, (sockaddr*) &addr, sizeof(addr)) < 0) {
+    throw_errno(string("cannot bind ") + path);
+  }
+  if (listen(listener, SOMAXCONN) < 0) {
+    throw_errno("cannot listen");
+  }
+  set_nonblocking(listener);
+
+  int epoll_fd = epoll_create1(0);
+  if (epoll_fd < 0) {
+    throw_errno("cannot create the epoll instance");
+  }
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.u64 = LISTENER_KEY;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &event) < 0) {
+    throw_errno("cannot watch the socket");
+  }
+  // the requests still being evaluated share the queue with the loop
+  shared_ptr<ReplyQueue> replies(new ReplyQueue());
+  event.events = EPOLLIN;
+  event.data.u64 = REPLIES_KEY;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, replies->fd(), &event) < 0) {
+    throw_errno("cannot watch the reply queue");
+  }
+
+  map<uint64_t, Connection> connections;
+  uint64_t next_key = FIRST_CONNECTION;
+  epoll_event events[MAX_EVENTS];
+  while (true) {
+    int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      throw_errno("cannot wait for the clients");
+    }
+
+    for (int i = 0; i < ready; ++i) {
+      uint64_t key = events[i].data.u64;
+      if (key == LISTENER_KEY) {
+	int client;
+	while ((client = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+	  event.events = EPOLLIN;
+	  event.data.u64 = next_key;
+	  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &event) < 0) {
+	    close(client);
+	    continue;
+	  }
+	  Connection& conn = connections[next_key++];
+	  conn.fd = client;
+	  conn.closing = false;
+	  conn.requests = 0;
+	  conn.replies = 0;
+	}
+	continue;
+      }
+
+      if (key == REPLIES_KEY) {
+	vector<uint64_t> keys = deliver_replies(*replies, connections);
+	for (vector<uint64_t>::size_type k = 0; k < keys.size(); ++k) {
+	  map<uint64_t, Connection>::iterator it = connections.find(keys[k]);
+	  if (it != connections.end() && !update_connection(epoll_fd, it->first, it->second)) {
+	    connections.erase(it);
+	  }
+	}
+	continue;
+      }
+
+      map<uint64_t, Connection>::iterator it = connections.find(key);
+      if (it == connections.end()) {
+	continue;
+      }
+      Connection& conn = it->second;
+      if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+	// the client closed both ways, and can take no more replies
+	close(conn.fd);
+	connections.erase(it);
+	continue;
+      }
+      if (events[i].events & EPOLLIN) {
+	read_requests(proto, replies, key, conn);
+      }
+      if (!update_connection(epoll_fd, key, conn)) {
+	connections.erase(it);
+      }
+    }
+  }
+}
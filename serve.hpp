@@ -0,0 +1,46 @@
+/**
+ * \file serve.hpp
+ *
+ * Encapsulates the REPL server, which keeps one interpreter loaded and
+ * answers the requests of any number of clients over a Unix domain socket.
+ *
+ * A request is one line of text holding any number of s-expressions. It is
+ * evaluated on a copy of the global definitions of the server, taken in
+ * constant time, so nothing it defines is seen by later requests. The reply
+ * is a header line "OUT ERR MICROS", then OUT bytes of printed results and
+ * ERR bytes of error messages. OUT and ERR are byte counts, and MICROS is
+ * the time the evaluation took in microseconds. Replies come in the order
+ * of the requests of the connection.
+ *
+ * Unless a time limit is given, every top-level expression of a request
+ * gets SERVE_TIME_LIMIT_MS, so that no request holds a thread of the
+ * server forever.
+ */
+
+#ifndef SERVE_HPP
+#define SERVE_HPP
+
+#include "Interpreter.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * \brief Milliseconds an expression of a request may run when the server
+ * is given no time limit.
+ */
+const long SERVE_TIME_LIMIT_MS = 10000;
+
+/**
+ * \brief Listen on a Unix domain socket at path, replacing a socket left
+ * there (error if anything else is there), and answer requests against the
+ * definitions of proto until the process is stopped. The connections are
+ * multiplexed with epoll on the calling thread, while the requests are
+ * evaluated on the worker pool, so that a slow one holds up no other
+ * client. On a single core, they are evaluated one at a time on the
+ * calling thread.
+ * \return Never, but throws if the socket cannot be set up.
+ */
+void serve(Interpreter& proto, const char* path) throw (runtime_error);
+
+#endif // SERVE_HPP
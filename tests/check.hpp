@@ -0,0 +1,100 @@
+/**
+ * \file check.hpp
+ *
+ * Minimal checks for the test programs linked against libmicrolisp.a. A
+ * failed check prints where it failed and is counted; main() ends with
+ * check_report(), which prints "name: ok" or "name: FAILED" as make test
+ * does for the s-expression tests.
+ */
+
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include "../cons.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+/**
+ * \brief Number of checks failed so far.
+ */
+static int check_failures = 0;
+
+/**
+ * \brief Record a failed check.
+ * \return Void.
+ */
+inline void check_failed(const char* file, int line, const string& what)
+{
+  cerr << file << ":" << line << ": check failed: " << what << endl;
+  ++check_failures;
+}
+
+/**
+ * \brief Render c as print would, "()" for nil.
+ * \return The text.
+ */
+inline string show(Cell* const c)
+{
+  string out;
+  if (c == nil) {
+    out = "()";
+  } else {
+    c->render(out);
+  }
+  return out;
+}
+
+/**
+ * \brief Print the outcome of the test program name.
+ * \return Its exit status.
+ */
+inline int check_report(const char* name)
+{
+  cout << name << (check_failures == 0 ? ": ok" : ": FAILED") << endl;
+  return check_failures == 0 ? 0 : 1;
+}
+
+/**
+ * \brief Check that cond holds.
+ */
+#define CHECK(cond)							\
+  do {									\
+    if (!(cond)) {							\
+      check_failed(__FILE__, __LINE__, #cond);				\
+    }									\
+  } while (0)
+
+/**
+ * \brief Check that evaluating expr gives a cell rendered as text,
+ * without throwing.
+ */
+#define CHECK_SHOW(expr, text)						\
+  do {									\
+    try {								\
+      string shown = show(expr);					\
+      if (shown != (text)) {						\
+	check_failed(__FILE__, __LINE__, string(#expr) + " is " + shown); \
+      }									\
+    } catch (exception& e) {						\
+      check_failed(__FILE__, __LINE__, string(#expr) + " throws " + e.what()); \
+    }									\
+  } while (0)
+
+/**
+ * \brief Check that evaluating expr throws an exception of type.
+ */
+#define CHECK_THROWS(expr, type)					\
+  do {									\
+    try {								\
+      (void) (expr);							\
+      check_failed(__FILE__, __LINE__, string(#expr) + " does not throw"); \
+    } catch (type&) {							\
+    } catch (exception& e) {						\
+      check_failed(__FILE__, __LINE__, string(#expr) + " throws " + e.what()); \
+    }									\
+  } while (0)
+
+#endif // CHECK_HPP
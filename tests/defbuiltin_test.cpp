@@ -0,0 +1,126 @@
+/**
+ * \file defbuiltin_test.cpp
+ *
+ * Tests of defbuiltin: the arity of the bound functions, the conversion of
+ * their arguments and results, and the errors of arguments of the wrong
+ * type.
+ */
+
+#include "check.hpp"
+#include "../defbuiltin.hpp"
+#include <cstring>
+
+/**
+ * \brief Evaluate the s-expressions of text in interp.
+ * \return The value of the last one.
+ */
+Cell* run(Interpreter& interp, const char* text)
+{
+  return eval_buffer(interp, text, strlen(text));
+}
+
+int add(int a, int b) { return a + b; }
+double half(double x) { return x / 2; }
+bool invert(bool b) { return !b; }
+string twice(const string& s) { return s + s; }
+int total(vector<int> values)
+{
+  int sum = 0;
+  for (vector<int>::size_type i = 0; i < values.size(); ++i) {
+    sum += values[i];
+  }
+  return sum;
+}
+vector<double> halves(const vector<double>& values)
+{
+  vector<double> results;
+  for (vector<double>::size_type i = 0; i < values.size(); ++i) {
+    results.push_back(values[i] / 2);
+  }
+  return results;
+}
+Cell* second(Cell* list) { return car(cdr(list)); }
+int answer() { return 42; }
+
+int calls = 0;
+void touch_counter(int n) { calls += n; }
+
+void test_conversions()
+{
+  Interpreter interp;
+  defbuiltin<int(int, int)>(interp, "add", add);
+  defbuiltin<double(double)>(interp, "half", half);
+  defbuiltin<bool(bool)>(interp, "invert", invert);
+  defbuiltin<string(const string&)>(interp, "twice", twice);
+  defbuiltin<int(vector<int>)>(interp, "total", total);
+  defbuiltin<vector<double>(const vector<double>&)>(interp, "halves", halves);
+  defbuiltin<Cell*(Cell*)>(interp, "second", second);
+  defbuiltin<int()>(interp, "answer", answer);
+
+  CHECK_SHOW(run(interp, "(add 2 3)"), "5");
+  CHECK_SHOW(run(interp, "(half 3)"), "1.5");
+  CHECK_SHOW(run(interp, "(half 5.0)"), "2.5");
+  CHECK_SHOW(run(interp, "(invert 0)"), "1");
+  CHECK_SHOW(run(interp, "(invert 0.5)"), "0");
+  CHECK_SHOW(run(interp, "(twice (quote ab))"), "abab");
+  CHECK_SHOW(run(interp, "(total (quote (1 2 3)))"), "6");
+  CHECK_SHOW(run(interp, "(total (quote ()))"), "0");
+  CHECK_SHOW(run(interp, "(halves (quote (1 3.0)))"), "(0.5 1.5)");
+  CHECK_SHOW(run(interp, "(second (quote (a (b c) d)))"), "(b c)");
+  CHECK_SHOW(run(interp, "(answer)"), "42");
+  CHECK_SHOW(run(interp, "(pmap half (quote (1 2)))"), "(0.5 1.0)");
+}
+
+void test_void()
+{
+  Interpreter interp;
+  defbuiltin<void(int)>(interp, "touch-counter", touch_counter);
+  calls = 0;
+  CHECK_SHOW(run(interp, "(touch-counter 3)"), "()");
+  CHECK_SHOW(run(interp, "(touch-counter 4)"), "()");
+  CHECK(calls == 7);
+  CHECK_THROWS(run(interp, "(touch-counter a)"), runtime_error);
+  CHECK(calls == 7);
+}
+
+void test_arity()
+{
+  Interpreter interp;
+  defbuiltin<int(int, int)>(interp, "add", add);
+  defbuiltin<int()>(interp, "answer", answer);
+  CHECK_THROWS(run(interp, "(add 1)"), runtime_error);
+  CHECK_THROWS(run(interp, "(add 1 2 3)"), runtime_error);
+  CHECK_THROWS(run(interp, "(answer 1)"), runtime_error);
+}
+
+void test_unboxing_errors()
+{
+  Interpreter interp;
+  defbuiltin<int(int, int)>(interp, "add", add);
+  defbuiltin<double(double)>(interp, "half", half);
+  defbuiltin<bool(bool)>(interp, "invert", invert);
+  defbuiltin<string(const string&)>(interp, "twice", twice);
+  defbuiltin<int(vector<int>)>(interp, "total", total);
+
+  CHECK_THROWS(run(interp, "(add 1 2.5)"), runtime_error);
+  CHECK_THROWS(run(interp, "(add a 2)"), runtime_error);
+  CHECK_THROWS(run(interp, "(add (quote (1)) 2)"), runtime_error);
+  CHECK_THROWS(run(interp, "(half a)"), runtime_error);
+  CHECK_THROWS(run(interp, "(half (quote (1)))"), runtime_error);
+  CHECK_THROWS(run(interp, "(invert a)"), runtime_error);
+  CHECK_THROWS(run(interp, "(twice 1)"), runtime_error);
+  CHECK_THROWS(run(interp, "(twice (quote (a)))"), runtime_error);
+  CHECK_THROWS(run(interp, "(total 1)"), runtime_error);
+  CHECK_THROWS(run(interp, "(total (quote (1 a 3)))"), runtime_error);
+  // the interpreter stays usable
+  CHECK_SHOW(run(interp, "(add 1 2)"), "3");
+}
+
+int main()
+{
+  test_conversions();
+  test_void();
+  test_arity();
+  test_unboxing_errors();
+  return check_report("defbuiltin");
+}
@@ -0,0 +1,201 @@
+/**
+ * \file embed_test.cpp
+ *
+ * Tests of the interface for embedding the interpreter: evaluating
+ * buffers, defining native procedures and values, calling procedures from
+ * C++, and native procedures in pmap, preduce and heap images.
+ */
+
+#include "check.hpp"
+#include "../microlisp.hpp"
+#include "../image.hpp"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+/**
+ * \brief Evaluate the s-expressions of text in interp.
+ * \return The value of the last one.
+ */
+Cell* run(Interpreter& interp, const char* text)
+{
+  return eval_buffer(interp, text, strlen(text));
+}
+
+/**
+ * \brief A native procedure adding one to an int.
+ * \return The sum.
+ */
+Cell* native_inc(Interpreter&, Cell* const argv[], int, void*)
+{
+  return make_int(get_int(argv[0]) + 1);
+}
+
+/**
+ * \brief A native procedure adding any number of ints, and the int data
+ * points to.
+ * \return The sum.
+ */
+Cell* native_add(Interpreter&, Cell* const argv[], int argc, void* data)
+{
+  int sum = *(int*) data;
+  for (int i = 0; i < argc; ++i) {
+    sum += get_int(argv[i]);
+  }
+  return make_int(sum);
+}
+
+/**
+ * \brief A native procedure that always fails.
+ * \return Never.
+ */
+Cell* native_fail(Interpreter&, Cell* const[], int, void*)
+{
+  throw runtime_error("native failure");
+}
+
+/**
+ * \brief Define the native procedures of the tests in interp.
+ * \return Void.
+ */
+void define_natives(Interpreter& interp)
+{
+  static int zero = 0;
+  define_native(interp, "inc", native_inc, 1, 1);
+  define_native(interp, "add", native_add, 0, NativeProcedureCell::VARIADIC, &zero);
+  define_native(interp, "fail", native_fail, 0, 0);
+}
+
+void test_eval_buffer()
+{
+  Interpreter interp;
+  CHECK_SHOW(run(interp, ""), "()");
+  CHECK_SHOW(run(interp, "(define x 2) (+ x 3)"), "5");
+  CHECK_SHOW(run(interp, "  x\n"), "2");
+  // the definitions before a malformed s-expression stay
+  CHECK_THROWS(run(interp, "(define y 1) (+ y"), runtime_error);
+  CHECK_SHOW(lookup_value(interp, "y"), "1");
+  CHECK_THROWS(run(interp, "(car 5)"), runtime_error);
+  CHECK_THROWS(lookup_value(interp, "undefined"), runtime_error);
+}
+
+void test_print()
+{
+  ostringstream out;
+  ostringstream err;
+  Interpreter interp(out, err);
+  run(interp, "(print 3) (print (quote (a b)))");
+  interp.out_buffer().flush();
+  CHECK(out.str() == "3\n(a b)\n");
+}
+
+void test_define_native()
+{
+  Interpreter interp;
+  define_natives(interp);
+  CHECK_SHOW(run(interp, "(inc 4)"), "5");
+  CHECK_SHOW(run(interp, "((lambda (f) (f 9)) inc)"), "10");
+  CHECK_SHOW(run(interp, "(add)"), "0");
+  CHECK_SHOW(run(interp, "(add 1 2 3 (inc 3))"), "10");
+  CHECK_SHOW(run(interp, "(procedurep inc)"), "1");
+  CHECK_SHOW(run(interp, "(procedurep 3)"), "0");
+  CHECK_SHOW(get_name(lookup_value(interp, "inc")), "inc");
+  CHECK_THROWS(run(interp, "(inc)"), runtime_error);
+  CHECK_THROWS(run(interp, "(inc 1 2)"), runtime_error);
+  CHECK_THROWS(run(interp, "(fail)"), runtime_error);
+  // the interpreter stays usable after a native procedure fails
+  CHECK_SHOW(run(interp, "(inc (inc 0))"), "2");
+}
+
+void test_define_value()
+{
+  Interpreter interp;
+  define_value(interp, "seven", make_int(7));
+  define_value(interp, "pair", cons(make_symbol("a"), cons(make_double(1.5), nil)));
+  CHECK_SHOW(run(interp, "seven"), "7");
+  // a value is not evaluated again when defined
+  CHECK_SHOW(run(interp, "pair"), "(a 1.5)");
+  define_value(interp, "twice", run(interp, "(lambda (n) (* 2 n))"));
+  CHECK_SHOW(get_name(lookup_value(interp, "twice")), "twice");
+}
+
+void test_call()
+{
+  Interpreter interp;
+  define_natives(interp);
+  run(interp, "(define twice (lambda (n) (* 2 n)))");
+  Cell* argv[] = { make_int(41), make_int(1) };
+  CHECK_SHOW(call(interp, lookup_value(interp, "inc"), argv, 1), "42");
+  CHECK_SHOW(call(interp, lookup_value(interp, "twice"), argv, 1), "82");
+  CHECK_SHOW(call(interp, make_symbol("+"), argv, 2), "42");
+  // the arguments are values, not expressions
+  Cell* list[] = { cons(make_symbol("a"), nil) };
+  CHECK_SHOW(call(interp, make_symbol("car"), list, 1), "a");
+  CHECK_THROWS(call(interp, lookup_value(interp, "inc"), argv, 2), runtime_error);
+}
+
+void test_parallel()
+{
+  Interpreter interp;
+  define_natives(interp);
+  CHECK_SHOW(run(interp, "(pmap inc (quote (1 2 3)))"), "(2 3 4)");
+  CHECK_SHOW(run(interp, "(pmap inc (quote (1 2 3 4 5 6 7 8)) 1)"), "(2 3 4 5 6 7 8 9)");
+  CHECK_SHOW(run(interp, "(preduce add 0 (quote (1 2 3)))"), "6");
+  CHECK_SHOW(run(interp, "(preduce add 0 (quote (1 2 3 4 5 6 7 8)) 1)"), "36");
+  CHECK_SHOW(run(interp, "(touch (future (inc 1)))"), "2");
+  CHECK_THROWS(run(interp, "(pmap fail (quote (1)))"), runtime_error);
+}
+
+void test_future_outliving_streams()
+{
+  Cell* pending;
+  ostringstream* out = new ostringstream();
+  ostringstream* err = new ostringstream();
+  {
+    Interpreter interp(*out, *err);
+    run(interp, "(define count (lambda (n) (if (< n 1) 0 (count (- n 1)))))");
+    pending = run(interp, "(future (count 200000))");
+  }
+  delete out;
+  delete err;
+  // the interpreter and streams of the future's caller are gone, as those
+  // of a request of --serve or a file of --jobs are once it has finished
+  CHECK_SHOW(touch(pending), "0");
+}
+
+void test_image()
+{
+  const char* path = "embed_test.image";
+  {
+    Interpreter interp;
+    define_natives(interp);
+    run(interp, "(define twice (lambda (n) (inc (inc n)))) (define base 40)");
+    save_image(interp, path);
+  }
+  // the natives are not saved; the program defines them again
+  Interpreter interp;
+  define_natives(interp);
+  load_image(interp, path);
+  CHECK_SHOW(run(interp, "(twice base)"), "42");
+  CHECK_SHOW(run(interp, "(pmap twice (quote (1 2)))"), "(3 4)");
+
+  // without them, the procedures using them fail
+  Interpreter bare;
+  load_image(bare, path);
+  remove(path);
+  CHECK_THROWS(run(bare, "(twice base)"), runtime_error);
+  CHECK_THROWS(load_image(bare, path), runtime_error);
+}
+
+int main()
+{
+  test_eval_buffer();
+  test_print();
+  test_define_native();
+  test_define_value();
+  test_call();
+  test_parallel();
+  test_future_outliving_streams();
+  test_image();
+  return check_report("embed");
+}
@@ -0,0 +1,61 @@
+/**
+ * \file hashcons_test.cpp
+ *
+ * Tests of hash-consing: equal parsed cells are shared, and the sharing is
+ * not observable in the values of a program.
+ */
+
+#include "check.hpp"
+#include "../microlisp.hpp"
+#include <cstring>
+
+/**
+ * \brief Evaluate the s-expressions of text in interp.
+ * \return The value of the last one.
+ */
+Cell* run(Interpreter& interp, const char* text)
+{
+  return eval_buffer(interp, text, strlen(text));
+}
+
+void test_sharing()
+{
+  Interpreter interp;
+  interp.set_hashcons(true);
+  Cell* first = run(interp, "(quote (a (1 2.5)))");
+  Cell* second = run(interp, "(quote (a (1 2.5)))");
+  CHECK(first == second);
+  CHECK_SHOW(first, "(a (1 2.5))");
+  CHECK(run(interp, "(quote (1 2))") != run(interp, "(quote (1 3))"));
+}
+
+void test_signed_zero()
+{
+  Interpreter plain;
+  Interpreter interp;
+  interp.set_hashcons(true);
+  const char* cases[] = { "0.0", "-0.0", "(/ 1.0 -0.0)", "(/ 1.0 0.0)", "(quote (0.0 -0.0))" };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    CHECK(show(run(interp, cases[i])) == show(run(plain, cases[i])));
+  }
+  CHECK_SHOW(run(interp, "-0.0"), "-0.0");
+  CHECK_SHOW(run(interp, "(/ 1.0 -0.0)"), "-inf");
+  CHECK(run(interp, "0.0") != run(interp, "-0.0"));
+}
+
+void test_memoized_signed_zero()
+{
+  Interpreter interp;
+  run(interp, "(define inverse (memoize (lambda (x) (/ 1.0 x))))");
+  CHECK_SHOW(run(interp, "(inverse 0.0)"), "inf");
+  CHECK_SHOW(run(interp, "(inverse -0.0)"), "-inf");
+  CHECK_SHOW(run(interp, "(inverse 0.0)"), "inf");
+}
+
+int main()
+{
+  test_sharing();
+  test_signed_zero();
+  test_memoized_signed_zero();
+  return check_report("hashcons");
+}